@@ -0,0 +1,227 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocator.h"
+
+#define CHUNK_SIZE (64 * 1024)
+#define CHUNK_MASK (~(uintptr_t)(CHUNK_SIZE - 1))
+#define MAX_SMALL_SIZE 512
+#define NUM_CLASSES 16
+#define ALIGNMENT 16
+
+static const uint32_t classSizes[NUM_CLASSES] = {
+  16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512
+};
+
+// Size class for every multiple of ALIGNMENT up to MAX_SMALL_SIZE
+static const uint8_t classForSize[MAX_SMALL_SIZE / ALIGNMENT + 1] = {
+  0, 0, 1, 2, 3, 4, 5, 6, 7,
+  8, 8, 9, 9, 10, 10, 11, 11,
+  12, 12, 12, 12, 13, 13, 13, 13,
+  14, 14, 14, 14, 15, 15, 15, 15
+};
+
+typedef struct FreeSlot {
+  struct FreeSlot* next;
+} FreeSlot;
+
+// Every chunk starts with its header, the slots follow
+typedef struct Chunk {
+  struct Chunk* next;
+  uint32_t sizeClass;
+  uint32_t padding;
+} Chunk;
+
+#define CHUNK_HEADER_SIZE ((sizeof(Chunk) + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1))
+
+typedef struct LargeBlock {
+  struct LargeBlock* prev;
+  struct LargeBlock* next;
+  size_t size;
+  size_t padding;
+} LargeBlock;
+
+struct WrtArena {
+  FreeSlot* freeLists[NUM_CLASSES];
+  char* bump[NUM_CLASSES];
+  char* bumpEnd[NUM_CLASSES];
+  Chunk* chunks;
+  // Open-addressed set of chunk base addresses, tells slab memory apart
+  // from large blocks without a per-object header
+  uintptr_t* chunkSet;
+  size_t chunkSetCapacity;
+  size_t numChunks;
+  LargeBlock* large;
+};
+
+static inline size_t hash_chunk(uintptr_t base, size_t capacity){
+  return (size_t)((base / CHUNK_SIZE) * 0x9E3779B97F4A7C15ULL) & (capacity - 1);
+}
+
+static void chunk_set_insert(uintptr_t* set, size_t capacity, uintptr_t base){
+  size_t index = hash_chunk(base, capacity);
+  while(set[index] != 0){
+    index = (index + 1) & (capacity - 1);
+  }
+  set[index] = base;
+}
+
+static void chunk_set_add(WrtArena* arena, uintptr_t base){
+  if((arena->numChunks + 1) * 2 > arena->chunkSetCapacity){
+    size_t capacity = arena->chunkSetCapacity == 0 ? 16 : arena->chunkSetCapacity * 2;
+    uintptr_t* set = calloc(capacity, sizeof(uintptr_t));
+    for (size_t i = 0; i < arena->chunkSetCapacity; i++)
+    {
+      if(arena->chunkSet[i] != 0) chunk_set_insert(set, capacity, arena->chunkSet[i]);
+    }
+    free(arena->chunkSet);
+    arena->chunkSet = set;
+    arena->chunkSetCapacity = capacity;
+  }
+  chunk_set_insert(arena->chunkSet, arena->chunkSetCapacity, base);
+  arena->numChunks++;
+}
+
+static Chunk* find_chunk(WrtArena* arena, void* memory){
+  if(arena->chunkSetCapacity == 0) return NULL;
+  uintptr_t base = (uintptr_t)memory & CHUNK_MASK;
+  size_t index = hash_chunk(base, arena->chunkSetCapacity);
+  while(arena->chunkSet[index] != 0){
+    if(arena->chunkSet[index] == base) return (Chunk*)base;
+    index = (index + 1) & (arena->chunkSetCapacity - 1);
+  }
+  return NULL;
+}
+
+static void* aligned_chunk(){
+#if defined(_WIN32)
+  return _aligned_malloc(CHUNK_SIZE, CHUNK_SIZE);
+#else
+  void* memory = NULL;
+  return posix_memalign(&memory, CHUNK_SIZE, CHUNK_SIZE) == 0 ? memory : NULL;
+#endif
+}
+
+static void free_chunk(Chunk* chunk){
+#if defined(_WIN32)
+  _aligned_free(chunk);
+#else
+  free(chunk);
+#endif
+}
+
+static void* small_alloc(WrtArena* arena, uint32_t sizeClass){
+  FreeSlot* slot = arena->freeLists[sizeClass];
+  if(slot != NULL){
+    arena->freeLists[sizeClass] = slot->next;
+    return slot;
+  }
+  uint32_t size = classSizes[sizeClass];
+  if(arena->bump[sizeClass] + size > arena->bumpEnd[sizeClass]){
+    Chunk* chunk = aligned_chunk();
+    if(chunk == NULL) return NULL;
+    chunk->sizeClass = sizeClass;
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+    chunk_set_add(arena, (uintptr_t)chunk);
+    arena->bump[sizeClass] = (char*)chunk + CHUNK_HEADER_SIZE;
+    arena->bumpEnd[sizeClass] = (char*)chunk + CHUNK_SIZE;
+  }
+  void* memory = arena->bump[sizeClass];
+  arena->bump[sizeClass] += size;
+  return memory;
+}
+
+static void small_free(WrtArena* arena, Chunk* chunk, void* memory){
+  FreeSlot* slot = (FreeSlot*)memory;
+  slot->next = arena->freeLists[chunk->sizeClass];
+  arena->freeLists[chunk->sizeClass] = slot;
+}
+
+static void large_link(WrtArena* arena, LargeBlock* block){
+  block->prev = NULL;
+  block->next = arena->large;
+  if(arena->large != NULL) arena->large->prev = block;
+  arena->large = block;
+}
+
+static void large_unlink(WrtArena* arena, LargeBlock* block){
+  if(block->prev != NULL) block->prev->next = block->next;
+  else arena->large = block->next;
+  if(block->next != NULL) block->next->prev = block->prev;
+}
+
+static void* large_alloc(WrtArena* arena, size_t size){
+  LargeBlock* block = malloc(sizeof(LargeBlock) + size);
+  if(block == NULL) return NULL;
+  block->size = size;
+  large_link(arena, block);
+  return block + 1;
+}
+
+WrtArena* wrt_arena_new(void){
+  return calloc(1, sizeof(WrtArena));
+}
+
+size_t wrt_arena_size(WrtArena* arena, void* memory){
+  Chunk* chunk = find_chunk(arena, memory);
+  return chunk != NULL ? classSizes[chunk->sizeClass] : ((LargeBlock*)memory - 1)->size;
+}
+
+void* wrt_arena_realloc(WrtArena* arena, void* memory, size_t newSize){
+  if(memory == NULL){
+    if(newSize == 0) return NULL;
+    if(newSize <= MAX_SMALL_SIZE){
+      return small_alloc(arena, classForSize[(newSize + ALIGNMENT - 1) / ALIGNMENT]);
+    }
+    return large_alloc(arena, newSize);
+  }
+
+  Chunk* chunk = find_chunk(arena, memory);
+  if(chunk != NULL){
+    if(newSize == 0){
+      small_free(arena, chunk, memory);
+      return NULL;
+    }
+    size_t oldSize = classSizes[chunk->sizeClass];
+    if(newSize <= oldSize && newSize > (chunk->sizeClass > 0 ? classSizes[chunk->sizeClass - 1] : 0)){
+      return memory;
+    }
+    void* moved = wrt_arena_realloc(arena, NULL, newSize);
+    if(moved == NULL) return NULL;
+    memcpy(moved, memory, oldSize < newSize ? oldSize : newSize);
+    small_free(arena, chunk, memory);
+    return moved;
+  }
+
+  LargeBlock* block = (LargeBlock*)memory - 1;
+  large_unlink(arena, block);
+  if(newSize == 0){
+    free(block);
+    return NULL;
+  }
+  LargeBlock* resized = realloc(block, sizeof(LargeBlock) + newSize);
+  if(resized == NULL){
+    large_link(arena, block);
+    return NULL;
+  }
+  resized->size = newSize;
+  large_link(arena, resized);
+  return resized + 1;
+}
+
+void wrt_arena_free(WrtArena* arena){
+  while(arena->chunks != NULL){
+    Chunk* chunk = arena->chunks;
+    arena->chunks = chunk->next;
+    free_chunk(chunk);
+  }
+  while(arena->large != NULL){
+    LargeBlock* block = arena->large;
+    arena->large = block->next;
+    free(block);
+  }
+  free(arena->chunkSet);
+  free(arena);
+}
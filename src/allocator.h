@@ -0,0 +1,19 @@
+#ifndef WRT_ALLOCATOR_H
+#define WRT_ALLOCATOR_H
+
+#include <stddef.h>
+
+// Size-class slab allocator owned by a single VM. Small objects are bump
+// allocated from 64 KiB chunks that each serve one size class and are
+// recycled through per-class free lists. A VM only runs on one thread at a
+// time, so none of this is locked. Larger blocks go to malloc and are
+// tracked so the whole arena is released at once.
+typedef struct WrtArena WrtArena;
+
+WrtArena* wrt_arena_new(void);
+void* wrt_arena_realloc(WrtArena* arena, void* memory, size_t newSize);
+// Returns the usable size of a block allocated from the arena
+size_t wrt_arena_size(WrtArena* arena, void* memory);
+void wrt_arena_free(WrtArena* arena);
+
+#endif
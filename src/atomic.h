@@ -0,0 +1,21 @@
+#ifndef WRT_ATOMIC_H
+#define WRT_ATOMIC_H
+
+#if defined(_MSC_VER)
+    #include <windows.h>
+    #define ATOMIC_LOAD_PTR(p) InterlockedCompareExchangePointer((PVOID volatile*)(p), NULL, NULL)
+    #define ATOMIC_STORE_PTR(p, v) InterlockedExchangePointer((PVOID volatile*)(p), (PVOID)(v))
+    #define ATOMIC_LOAD_INT(p) InterlockedCompareExchange((LONG volatile*)(p), 0, 0)
+    #define ATOMIC_STORE_INT(p, v) InterlockedExchange((LONG volatile*)(p), (LONG)(v))
+    #define ATOMIC_FETCH_ADD_INT(p, v) InterlockedExchangeAdd((LONG volatile*)(p), (LONG)(v))
+    #define ATOMIC_CAS_INT(p, e, v) (InterlockedCompareExchange((LONG volatile*)(p), (LONG)(v), (LONG)(e)) == (LONG)(e))
+#else
+    #define ATOMIC_LOAD_PTR(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+    #define ATOMIC_STORE_PTR(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+    #define ATOMIC_LOAD_INT(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+    #define ATOMIC_STORE_INT(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+    #define ATOMIC_FETCH_ADD_INT(p, v) __atomic_fetch_add((p), (v), __ATOMIC_ACQ_REL)
+    #define ATOMIC_CAS_INT(p, e, v) __sync_bool_compare_and_swap((p), (e), (v))
+#endif
+
+#endif
@@ -0,0 +1,236 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <wrt_hash.h>
+
+#include "bindings.h"
+
+#define MIN_CAPACITY 64
+// Average number of keys per perfect hash bucket
+#define KEYS_PER_BUCKET 4
+#define MAX_BUCKET_SIZE 64
+#define MAX_SEED_ATTEMPTS (1 << 20)
+
+uint64_t wrt_binding_hash(const char** parts, int numParts){
+  uint64_t hash = WRT_FNV_OFFSET;
+  for (int i = 0; i < numParts; i++)
+  {
+    if(i > 0){
+      hash = WRT_FNV_STEP(hash, '.');
+    }
+    hash = wrt_hash_string(hash, parts[i]);
+  }
+  return hash;
+}
+
+uint64_t wrt_binding_hash_string(const char* name){
+  return wrt_hash_string(WRT_FNV_OFFSET, name);
+}
+
+bool wrt_binding_matches(const char* name, const char** parts, int numParts){
+  for (int i = 0; i < numParts; i++)
+  {
+    if(i > 0 && *name++ != '.') return false;
+    const char* part = parts[i];
+    while(*part){
+      if(*name++ != *part++) return false;
+    }
+  }
+  return *name == 0;
+}
+
+static void insert(WrtBinding* entries, uint32_t capacity, const WrtBinding* binding){
+  uint32_t mask = capacity - 1;
+  uint32_t index = (uint32_t)binding->hash & mask;
+  while(entries[index].name != NULL){
+    index = (index + 1) & mask;
+  }
+  entries[index] = *binding;
+}
+
+static void grow(WrtBindingTable* table){
+  uint32_t capacity = table->capacity == 0 ? MIN_CAPACITY : table->capacity * 2;
+  WrtBinding* entries = calloc(capacity, sizeof(WrtBinding));
+  for (uint32_t i = 0; i < table->capacity; i++)
+  {
+    if(table->entries[i].name != NULL){
+      insert(entries, capacity, &table->entries[i]);
+    }
+  }
+  free(table->entries);
+  table->entries = entries;
+  table->capacity = capacity;
+}
+
+void wrt_binding_table_put(WrtBindingTable* table, uint64_t hash, const char* name, WrenForeignMethodFn fn, WrenFinalizerFn finalizer){
+  const char* parts[] = { name };
+  WrtBinding* existing = (WrtBinding*)wrt_binding_table_find(table, hash, parts, 1);
+  if(existing != NULL){
+    existing->fn = fn;
+    existing->finalizer = finalizer;
+    return;
+  }
+  // Keep the load factor at or below one half so probe sequences stay short
+  if((table->count + 1) * 2 > table->capacity){
+    grow(table);
+  }
+  WrtBinding binding = { hash, name, fn, finalizer };
+  insert(table->entries, table->capacity, &binding);
+  table->count++;
+}
+
+const WrtBinding* wrt_binding_table_find(const WrtBindingTable* table, uint64_t hash, const char** parts, int numParts){
+  if(table->capacity == 0) return NULL;
+  uint32_t mask = table->capacity - 1;
+  uint32_t index = (uint32_t)hash & mask;
+  while(table->entries[index].name != NULL){
+    const WrtBinding* binding = &table->entries[index];
+    if(binding->hash == hash && wrt_binding_matches(binding->name, parts, numParts)){
+      return binding;
+    }
+    index = (index + 1) & mask;
+  }
+  return NULL;
+}
+
+void wrt_binding_table_free(WrtBindingTable* table){
+  free(table->entries);
+  table->entries = NULL;
+  table->capacity = 0;
+  table->count = 0;
+}
+
+static inline uint32_t sealed_bucket(uint64_t hash, uint32_t numBuckets){
+  return (uint32_t)(((hash >> 32) * (uint64_t)numBuckets) >> 32);
+}
+
+static inline uint32_t sealed_slot(uint64_t hash, uint32_t seed, uint32_t count){
+  uint64_t x = hash ^ ((uint64_t)seed * 0x9E3779B97F4A7C15ULL);
+  x ^= x >> 33;
+  x *= 0xFF51AFD7ED558CCDULL;
+  x ^= x >> 33;
+  return (uint32_t)(((x & 0xFFFFFFFF) * (uint64_t)count) >> 32);
+}
+
+typedef struct {
+  uint32_t bucket;
+  uint32_t size;
+  uint32_t first;
+} BucketInfo;
+
+static const WrtBinding** sort_keys;
+
+static int compare_keys_by_bucket(const void* a, const void* b){
+  uint32_t ia = *(const uint32_t*)a, ib = *(const uint32_t*)b;
+  uint64_t ha = sort_keys[ia]->hash, hb = sort_keys[ib]->hash;
+  return (ha >> 32) < (hb >> 32) ? -1 : (ha >> 32) > (hb >> 32) ? 1 : 0;
+}
+
+static int compare_buckets_by_size(const void* a, const void* b){
+  const BucketInfo* ba = a;
+  const BucketInfo* bb = b;
+  return (int)bb->size - (int)ba->size;
+}
+
+// Hash and displace: buckets are placed largest first, each one searches for
+// the first seed that sends all of its keys to slots that are still free.
+// Returns NULL if no placement is found, the caller keeps the mutable table.
+WrtSealedBindings* wrt_binding_seal(const WrtBindingTable* table){
+  WrtSealedBindings* sealed = calloc(1, sizeof(WrtSealedBindings));
+  uint32_t count = table->count;
+  sealed->count = count;
+  sealed->numBuckets = count / KEYS_PER_BUCKET + 1;
+  sealed->seeds = calloc(sealed->numBuckets, sizeof(uint32_t));
+  sealed->entries = calloc(count > 0 ? count : 1, sizeof(WrtBinding));
+  if(count == 0) return sealed;
+
+  const WrtBinding** keys = malloc(count * sizeof(WrtBinding*));
+  uint32_t* order = malloc(count * sizeof(uint32_t));
+  uint32_t n = 0;
+  for (uint32_t i = 0; i < table->capacity; i++)
+  {
+    if(table->entries[i].name != NULL){
+      keys[n] = &table->entries[i];
+      order[n] = n;
+      n++;
+    }
+  }
+  // Sorting by the bucket hash bits keeps every bucket's keys contiguous
+  sort_keys = keys;
+  qsort(order, count, sizeof(uint32_t), compare_keys_by_bucket);
+
+  BucketInfo* buckets = calloc(sealed->numBuckets, sizeof(BucketInfo));
+  for (uint32_t i = 0; i < sealed->numBuckets; i++)
+  {
+    buckets[i].bucket = i;
+  }
+  for (uint32_t i = 0; i < count; i++)
+  {
+    BucketInfo* bucket = &buckets[sealed_bucket(keys[order[i]]->hash, sealed->numBuckets)];
+    if(bucket->size == 0) bucket->first = i;
+    bucket->size++;
+  }
+  qsort(buckets, sealed->numBuckets, sizeof(BucketInfo), compare_buckets_by_size);
+
+  bool* taken = calloc(count, sizeof(bool));
+  uint32_t slots[MAX_BUCKET_SIZE];
+  bool complete = true;
+  for (uint32_t b = 0; b < sealed->numBuckets && buckets[b].size > 0 && complete; b++)
+  {
+    BucketInfo* bucket = &buckets[b];
+    uint32_t size = bucket->size;
+    // Oversized buckets or full 64 bit hash collisions can not be placed
+    complete = size <= MAX_BUCKET_SIZE;
+    for (uint32_t seed = 0; complete && seed < MAX_SEED_ATTEMPTS; seed++)
+    {
+      uint32_t placed = 0;
+      for (; placed < size; placed++)
+      {
+        uint32_t slot = sealed_slot(keys[order[bucket->first + placed]]->hash, seed, count);
+        bool clash = taken[slot];
+        for (uint32_t j = 0; j < placed && !clash; j++)
+        {
+          clash = slots[j] == slot;
+        }
+        if(clash) break;
+        slots[placed] = slot;
+      }
+      if(placed == size){
+        for (uint32_t j = 0; j < size; j++)
+        {
+          taken[slots[j]] = true;
+          sealed->entries[slots[j]] = *keys[order[bucket->first + j]];
+        }
+        sealed->seeds[bucket->bucket] = seed;
+        break;
+      }
+      complete = seed + 1 < MAX_SEED_ATTEMPTS;
+    }
+  }
+
+  free(taken);
+  free(buckets);
+  free(order);
+  free(keys);
+  if(!complete){
+    wrt_sealed_free(sealed);
+    return NULL;
+  }
+  return sealed;
+}
+
+const WrtBinding* wrt_sealed_find(const WrtSealedBindings* sealed, uint64_t hash, const char** parts, int numParts){
+  if(sealed == NULL || sealed->count == 0) return NULL;
+  uint32_t seed = sealed->seeds[sealed_bucket(hash, sealed->numBuckets)];
+  const WrtBinding* binding = &sealed->entries[sealed_slot(hash, seed, sealed->count)];
+  if(binding->hash == hash && binding->name != NULL && wrt_binding_matches(binding->name, parts, numParts)){
+    return binding;
+  }
+  return NULL;
+}
+
+void wrt_sealed_free(WrtSealedBindings* sealed){
+  free(sealed->seeds);
+  free(sealed->entries);
+  free(sealed);
+}
@@ -0,0 +1,45 @@
+#ifndef WRT_BINDINGS_H
+#define WRT_BINDINGS_H
+
+#include <stdint.h>
+#include <wren.h>
+
+// Foreign methods are keyed "module.Class.signature", foreign classes
+// "module.Class". Hashes are FNV-1a over the dot-joined key, so hashing the
+// components one by one gives the same value as hashing the full string.
+typedef struct {
+  uint64_t hash;
+  const char* name;
+  WrenForeignMethodFn fn;
+  WrenFinalizerFn finalizer;
+} WrtBinding;
+
+typedef struct {
+  WrtBinding* entries;
+  uint32_t capacity;
+  uint32_t count;
+} WrtBindingTable;
+
+// Immutable minimal perfect hash built from a binding table: every key maps
+// to exactly one slot of a dense entry array, chosen by a per-bucket seed.
+typedef struct WrtSealedBindings {
+  uint32_t numBuckets;
+  uint32_t count;
+  uint32_t* seeds;
+  WrtBinding* entries;
+  struct WrtSealedBindings* next;
+} WrtSealedBindings;
+
+uint64_t wrt_binding_hash(const char** parts, int numParts);
+uint64_t wrt_binding_hash_string(const char* name);
+bool wrt_binding_matches(const char* name, const char** parts, int numParts);
+
+void wrt_binding_table_put(WrtBindingTable* table, uint64_t hash, const char* name, WrenForeignMethodFn fn, WrenFinalizerFn finalizer);
+const WrtBinding* wrt_binding_table_find(const WrtBindingTable* table, uint64_t hash, const char** parts, int numParts);
+void wrt_binding_table_free(WrtBindingTable* table);
+
+WrtSealedBindings* wrt_binding_seal(const WrtBindingTable* table);
+const WrtBinding* wrt_sealed_find(const WrtSealedBindings* sealed, uint64_t hash, const char** parts, int numParts);
+void wrt_sealed_free(WrtSealedBindings* sealed);
+
+#endif
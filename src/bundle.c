@@ -0,0 +1,86 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "bundle.h"
+#include "modules.h"
+#include "log.h"
+
+struct WrtBundle {
+  const char* base;
+  size_t size;
+  const WrtBundleEntry* entries;
+  uint32_t count;
+};
+
+// A string of exactly length bytes and its NUL at offset
+static bool valid_string(const char* base, size_t size, uint64_t offset, uint64_t length){
+  if(offset >= size || length >= size - offset) return false;
+  return memchr(base + offset, 0, (size_t)length + 1) == base + offset + length;
+}
+
+// Everything is checked once here so lookups can trust the index
+static bool validate(const char* base, size_t size){
+  if(size < sizeof(WrtBundleHeader)) return false;
+  const WrtBundleHeader* header = (const WrtBundleHeader*)base;
+  if(memcmp(header->magic, WRT_BUNDLE_MAGIC, sizeof(header->magic)) != 0) return false;
+  if(header->version != WRT_BUNDLE_VERSION) return false;
+  if(header->count > (size - sizeof(WrtBundleHeader)) / sizeof(WrtBundleEntry)) return false;
+
+  const WrtBundleEntry* entries = (const WrtBundleEntry*)(base + sizeof(WrtBundleHeader));
+  for (uint32_t i = 0; i < header->count; i++)
+  {
+    const WrtBundleEntry* entry = &entries[i];
+    if(i > 0 && entry->hash < entries[i - 1].hash) return false;
+    if(entry->nameOffset >= size) return false;
+    const char* name = base + entry->nameOffset;
+    size_t nameLength = strnlen(name, size - entry->nameOffset);
+    if(nameLength == size - entry->nameOffset) return false;
+    if(wrt_bundle_hash(name) != entry->hash) return false;
+    if(!valid_string(base, size, entry->sourceOffset, entry->sourceLength)) return false;
+  }
+  return true;
+}
+
+WrtBundle* wrt_bundle_open(const char* path){
+  size_t size;
+  const char* base = wrt_map_file(path, &size);
+  if(base == NULL) return NULL;
+  if(!validate(base, size)){
+    WRT_ERROR("Invalid module bundle %s", path);
+    wrt_unmap_file(base, size);
+    return NULL;
+  }
+
+  WrtBundle* bundle = malloc(sizeof(WrtBundle));
+  bundle->base = base;
+  bundle->size = size;
+  bundle->entries = (const WrtBundleEntry*)(base + sizeof(WrtBundleHeader));
+  bundle->count = ((const WrtBundleHeader*)base)->count;
+  WRT_DEBUG("Opened module bundle %s with %u modules", path, bundle->count);
+  return bundle;
+}
+
+static const WrtBundleEntry* find_entry(const char* base, const WrtBundleEntry* entries, uint32_t count, const char* name, uint64_t hash){
+  uint32_t low = 0;
+  uint32_t high = count;
+  while(low < high){
+    uint32_t mid = low + (high - low) / 2;
+    if(entries[mid].hash < hash){
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  for (; low < count && entries[low].hash == hash; low++)
+  {
+    if(strcmp(base + entries[low].nameOffset, name) == 0) return &entries[low];
+  }
+  return NULL;
+}
+
+const char* wrt_bundle_find(const WrtBundle* bundle, const char* name, uint32_t* flags){
+  const WrtBundleEntry* entry = find_entry(bundle->base, bundle->entries, bundle->count, name, wrt_bundle_hash(name));
+  if(entry == NULL) return NULL;
+  if(flags != NULL) *flags = entry->flags;
+  return bundle->base + entry->sourceOffset;
+}
@@ -0,0 +1,46 @@
+#ifndef WRT_BUNDLE_H
+#define WRT_BUNDLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <wrt_hash.h>
+
+// Bundle file layout, written by tools/wrt_bundle:
+//   WrtBundleHeader
+//   WrtBundleEntry[count], sorted by hash and then by name
+//   names and sources, each NUL terminated
+// Offsets are from the start of the file. Sources are served straight from
+// the mapping, the trailing NUL lets Wren compile them in place.
+#define WRT_BUNDLE_MAGIC "WRTBNDL"
+#define WRT_BUNDLE_VERSION 1
+// The module has a binary plugin next to it in the module root
+#define WRT_BUNDLE_HAS_BINARY 1
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t count;
+} WrtBundleHeader;
+
+typedef struct {
+  uint64_t hash;
+  uint64_t nameOffset;
+  uint64_t sourceOffset;
+  uint32_t sourceLength;
+  uint32_t flags;
+} WrtBundleEntry;
+
+static inline uint64_t wrt_bundle_hash(const char* name){
+  return wrt_hash_string(WRT_FNV_OFFSET, name);
+}
+
+typedef struct WrtBundle WrtBundle;
+
+// Maps a bundle for the rest of the process, NULL if it can not be read or
+// is malformed
+WrtBundle* wrt_bundle_open(const char* path);
+// Source of a bundled module, NULL if the bundle does not have it
+const char* wrt_bundle_find(const WrtBundle* bundle, const char* name, uint32_t* flags);
+
+#endif
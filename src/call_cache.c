@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "call_cache.h"
+#include "bindings.h"
+#include "log.h"
+
+#define MIN_CAPACITY 16
+
+static bool matches(const WrtCachedCall* call, const char* module, const char* variable, const char* signature){
+  return strcmp(call->signature, signature) == 0
+    && strcmp(call->variable, variable) == 0
+    && strcmp(call->module, module) == 0;
+}
+
+static WrtCachedCall* insert(WrtCachedCall* entries, uint32_t capacity, const WrtCachedCall* call){
+  uint32_t mask = capacity - 1;
+  uint32_t index = (uint32_t)call->hash & mask;
+  while(entries[index].module != NULL){
+    index = (index + 1) & mask;
+  }
+  entries[index] = *call;
+  return &entries[index];
+}
+
+static void grow(WrtCallCache* cache){
+  uint32_t capacity = cache->capacity == 0 ? MIN_CAPACITY : cache->capacity * 2;
+  WrtCachedCall* entries = calloc(capacity, sizeof(WrtCachedCall));
+  for (uint32_t i = 0; i < cache->capacity; i++)
+  {
+    if(cache->entries[i].module != NULL){
+      insert(entries, capacity, &cache->entries[i]);
+    }
+  }
+  free(cache->entries);
+  cache->entries = entries;
+  cache->capacity = capacity;
+}
+
+// Method names may contain underscores, parameters only follow the first
+// parenthesis or bracket
+static int count_arity(const char* signature){
+  const char* params = strpbrk(signature, "([");
+  int arity = 0;
+  for(const char* c = params; c != NULL && *c; c++){
+    if(*c == '_') arity++;
+  }
+  return arity;
+}
+
+static const WrtCachedCall* add_call(WrtCallCache* cache, WrenVM* vm, uint64_t hash, const char* module, const char* variable, const char* signature){
+  if(!wrenHasModule(vm, module) || !wrenHasVariable(vm, module, variable)){
+    WRT_ERROR("Can not call '%s' on unknown variable '%s' in module '%s'", signature, variable, module);
+    return NULL;
+  }
+  // Keep the load factor at or below one half so probe sequences stay short
+  if((cache->count + 1) * 2 > cache->capacity){
+    grow(cache);
+  }
+
+  size_t moduleLength = strlen(module) + 1;
+  size_t variableLength = strlen(variable) + 1;
+  char* names = malloc(moduleLength + variableLength + strlen(signature) + 1);
+  memcpy(names, module, moduleLength);
+  memcpy(names + moduleLength, variable, variableLength);
+  strcpy(names + moduleLength + variableLength, signature);
+
+  WrtCachedCall call;
+  call.hash = hash;
+  call.module = names;
+  call.variable = names + moduleLength;
+  call.signature = names + moduleLength + variableLength;
+  call.arity = count_arity(signature);
+  wrenEnsureSlots(vm, 1);
+  wrenGetVariable(vm, module, variable, 0);
+  call.receiver = wrenGetSlotHandle(vm, 0);
+  call.method = wrenMakeCallHandle(vm, signature);
+
+  cache->count++;
+  return insert(cache->entries, cache->capacity, &call);
+}
+
+const WrtCachedCall* wrt_call_cache_get(WrtCallCache* cache, WrenVM* vm, const char* module, const char* variable, const char* signature){
+  const char* parts[] = { module, variable, signature };
+  uint64_t hash = wrt_binding_hash(parts, 3);
+  if(cache->capacity > 0){
+    uint32_t mask = cache->capacity - 1;
+    uint32_t index = (uint32_t)hash & mask;
+    while(cache->entries[index].module != NULL){
+      const WrtCachedCall* call = &cache->entries[index];
+      if(call->hash == hash && matches(call, module, variable, signature)){
+        return call;
+      }
+      index = (index + 1) & mask;
+    }
+  }
+  return add_call(cache, vm, hash, module, variable, signature);
+}
+
+void wrt_call_cache_free(WrtCallCache* cache, WrenVM* vm){
+  for (uint32_t i = 0; i < cache->capacity; i++)
+  {
+    WrtCachedCall* call = &cache->entries[i];
+    if(call->module == NULL) continue;
+    wrenReleaseHandle(vm, call->receiver);
+    wrenReleaseHandle(vm, call->method);
+    free((void*)call->module);
+  }
+  free(cache->entries);
+  cache->entries = NULL;
+  cache->capacity = 0;
+  cache->count = 0;
+}
@@ -0,0 +1,31 @@
+#ifndef WRT_CALL_CACHE_H
+#define WRT_CALL_CACHE_H
+
+#include <stdint.h>
+#include <wren.h>
+
+// Receiver and call handles for host->Wren calls, keyed by the FNV-1a hash of
+// module, variable and signature. Owned by a single VM, so nothing is locked.
+typedef struct {
+  uint64_t hash;
+  // module, variable and signature share one allocation
+  const char* module;
+  const char* variable;
+  const char* signature;
+  int arity;
+  WrenHandle* receiver;
+  WrenHandle* method;
+} WrtCachedCall;
+
+typedef struct {
+  WrtCachedCall* entries;
+  uint32_t capacity;
+  uint32_t count;
+} WrtCallCache;
+
+// Returns NULL when the module or variable does not exist
+const WrtCachedCall* wrt_call_cache_get(WrtCallCache* cache, WrenVM* vm, const char* module, const char* variable, const char* signature);
+// Releases the handles, has to run before wrenFreeVM
+void wrt_call_cache_free(WrtCallCache* cache, WrenVM* vm);
+
+#endif
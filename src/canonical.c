@@ -0,0 +1,125 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include <stb_ds.h>
+
+#include "canonical.h"
+#include "mutex.h"
+
+#define WREN_EXTENSION ".wren"
+#define WREN_EXTENSION_LENGTH (sizeof(WREN_EXTENSION) - 1)
+
+typedef struct {
+  char* key;
+  // Interned canonical name
+  const char* value;
+} CanonicalEntry;
+
+typedef struct {
+  char* key;
+  int value;
+} InternedName;
+
+static MUTEX canonicalMutex;
+// Path as it was spelled -> interned canonical name
+static CanonicalEntry* canonicalNames = NULL;
+// Keys are the interned strings, stb_ds keeps them at a stable address
+static InternedName* interned = NULL;
+
+static char* real_path(const char* path){
+#if defined(_WIN32)
+  return _fullpath(NULL, path, 0);
+#else
+  return realpath(path, NULL);
+#endif
+}
+
+// Must be called with canonicalMutex held
+static const char* intern(const char* name){
+  ptrdiff_t index = shgeti(interned, name);
+  if(index < 0){
+    shput(interned, name, 0);
+    index = shgeti(interned, name);
+  }
+  return interned[index].key;
+}
+
+static bool ends_with(const char* str, size_t length, const char* suffix, size_t suffixLength){
+  return length >= suffixLength && memcmp(str + length - suffixLength, suffix, suffixLength) == 0;
+}
+
+// The installed name when real lies inside the real module root
+static bool name_under_root(const char* realRoot, const char* real, char* name){
+  size_t rootLength = strlen(realRoot);
+  size_t length = strlen(real);
+  if(rootLength > 0 && strncmp(real, realRoot, rootLength) == 0
+    && (real[rootLength] == '/' || real[rootLength] == '\\')
+    && ends_with(real, length, WREN_EXTENSION, WREN_EXTENSION_LENGTH)
+    && length > rootLength + 1 + WREN_EXTENSION_LENGTH){
+    size_t nameLength = length - rootLength - 1 - WREN_EXTENSION_LENGTH;
+    memcpy(name, real + rootLength + 1, nameLength);
+    name[nameLength] = 0;
+    return true;
+  }
+  return false;
+}
+
+// Copies the canonical name of a spelling into name, false when the file
+// does not exist. The filesystem is only touched without the lock held.
+static bool lookup(const char* path, const char** roots, int numRoots, char* name){
+  MUTEX_LOCK(&canonicalMutex);
+  ptrdiff_t index = shgeti(canonicalNames, path);
+  if(index >= 0){
+    strcpy(name, canonicalNames[index].value);
+    MUTEX_UNLOCK(&canonicalMutex);
+    return true;
+  }
+  MUTEX_UNLOCK(&canonicalMutex);
+
+  // Missing files are not cached, they may still be created
+  char* real = real_path(path);
+  if(real == NULL) return false;
+  bool underRoot = false;
+  for (int i = 0; i < numRoots && !underRoot; i++)
+  {
+    char realRoot[PATH_MAX];
+    underRoot = lookup(roots[i], NULL, 0, realRoot) && name_under_root(realRoot, real, name);
+  }
+  if(!underRoot) strcpy(name, real);
+  free(real);
+
+  MUTEX_LOCK(&canonicalMutex);
+  shput(canonicalNames, path, intern(name));
+  MUTEX_UNLOCK(&canonicalMutex);
+  return true;
+}
+
+void wrt_canonical_init(void){
+  MUTEX_INIT(&canonicalMutex);
+  sh_new_strdup(canonicalNames);
+  sh_new_strdup(interned);
+}
+
+void wrt_canonical_before_fork(void){
+  MUTEX_LOCK(&canonicalMutex);
+}
+
+void wrt_canonical_after_fork(void){
+  MUTEX_UNLOCK(&canonicalMutex);
+}
+
+void wrt_canonical_file_module(const char** roots, int numRoots, const char* path, char* canonical){
+  if(!lookup(path, roots, numRoots, canonical)){
+    strcpy(canonical, path);
+  }
+}
+
+void wrt_canonical_clear(void){
+  MUTEX_LOCK(&canonicalMutex);
+  shfree(canonicalNames);
+  shfree(interned);
+  sh_new_strdup(canonicalNames);
+  sh_new_strdup(interned);
+  MUTEX_UNLOCK(&canonicalMutex);
+}
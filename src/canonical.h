@@ -0,0 +1,20 @@
+#ifndef WRT_CANONICAL_H
+#define WRT_CANONICAL_H
+
+#include <stdbool.h>
+
+// Canonical module names, so a module reached through different relative
+// paths or symlinks is loaded once. A file under one of the module roots maps
+// to its installed name, bindings and plugins are keyed by that. Any other
+// file maps to its real path. Real paths are cached per spelling and the
+// names are interned, both for the lifetime of the process or until cleared.
+void wrt_canonical_init(void);
+void wrt_canonical_before_fork(void);
+void wrt_canonical_after_fork(void);
+// Writes the canonical name of the file module at path into a PATH_MAX
+// buffer, roots are tried in order. A file that does not exist keeps path as
+// its name.
+void wrt_canonical_file_module(const char** roots, int numRoots, const char* path, char* canonical);
+void wrt_canonical_clear(void);
+
+#endif
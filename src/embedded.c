@@ -0,0 +1,103 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <wren_runtime.h>
+#include <stb_ds.h>
+
+#include "embedded.h"
+#include "atomic.h"
+#include "mutex.h"
+#include "log.h"
+
+#define MAX_EMBEDDED_TABLES 16
+
+typedef struct {
+  const WrtEmbeddedModule* modules;
+  int count;
+} EmbeddedTable;
+
+static EmbeddedTable tables[MAX_EMBEDDED_TABLES];
+// Slots are reserved atomically and published through their modules
+// pointer, lookups never take a lock
+static int numTables = 0;
+
+typedef struct {
+  char* key;
+  const char* value;
+} MemoryModule;
+
+static MUTEX memoryMutex;
+static MemoryModule* memoryModules = NULL;
+
+void wrt_memory_modules_init(void){
+  MUTEX_INIT(&memoryMutex);
+  sh_new_strdup(memoryModules);
+}
+
+void wrt_memory_modules_before_fork(void){
+  MUTEX_LOCK(&memoryMutex);
+}
+
+void wrt_memory_modules_after_fork(void){
+  MUTEX_UNLOCK(&memoryMutex);
+}
+
+void wrt_add_memory_module(const char* name, const char* source){
+  char* copy = malloc(strlen(source) + 1);
+  strcpy(copy, source);
+  MUTEX_LOCK(&memoryMutex);
+  bool added = shgeti(memoryModules, name) < 0;
+  if(added) shput(memoryModules, name, copy);
+  MUTEX_UNLOCK(&memoryMutex);
+  if(!added){
+    WRT_WARN("Memory module '%s' was added before", name);
+    free(copy);
+  }
+}
+
+void wrt_add_embedded_modules(const WrtEmbeddedModule* modules, int count){
+  if(count <= 0) return;
+  int slot = ATOMIC_FETCH_ADD_INT(&numTables, 1);
+  if(slot >= MAX_EMBEDDED_TABLES){
+    WRT_ERROR("Too many embedded module tables");
+    return;
+  }
+  tables[slot].count = count;
+  ATOMIC_STORE_PTR(&tables[slot].modules, modules);
+}
+
+static const char* find_in_table(const WrtEmbeddedModule* modules, int count, const char* name){
+  int low = 0;
+  int high = count;
+  while(low < high){
+    int mid = low + (high - low) / 2;
+    int order = strcmp(modules[mid].name, name);
+    if(order == 0) return modules[mid].source;
+    if(order < 0){
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return NULL;
+}
+
+const char* wrt_memory_module_find(const char* name){
+  // Sources are never released, the pointer stays valid after unlocking
+  MUTEX_LOCK(&memoryMutex);
+  ptrdiff_t index = shgeti(memoryModules, name);
+  const char* source = index >= 0 ? memoryModules[index].value : NULL;
+  MUTEX_UNLOCK(&memoryMutex);
+  if(source != NULL) return source;
+
+  int count = ATOMIC_LOAD_INT(&numTables);
+  if(count > MAX_EMBEDDED_TABLES) count = MAX_EMBEDDED_TABLES;
+  for (int i = 0; i < count; i++)
+  {
+    const WrtEmbeddedModule* modules = ATOMIC_LOAD_PTR(&tables[i].modules);
+    if(modules == NULL) continue;
+    source = find_in_table(modules, tables[i].count, name);
+    if(source != NULL) return source;
+  }
+  return NULL;
+}
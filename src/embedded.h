@@ -0,0 +1,12 @@
+#ifndef WRT_EMBEDDED_H
+#define WRT_EMBEDDED_H
+
+// Modules held in memory: tables compiled into the binary by
+// wrt_embed_modules and sources added at runtime. Neither is ever released,
+// a name that is added twice keeps its first source.
+void wrt_memory_modules_init(void);
+void wrt_memory_modules_before_fork(void);
+void wrt_memory_modules_after_fork(void);
+const char* wrt_memory_module_find(const char* name);
+
+#endif
@@ -0,0 +1,375 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+  #include <unistd.h>
+  #include <errno.h>
+  #include <sys/epoll.h>
+  #include <sys/eventfd.h>
+  #include <sys/timerfd.h>
+  #define WRT_LOOP_EPOLL
+#endif
+
+#include "event_loop.h"
+#include "os_call.h"
+#include "log.h"
+
+#define MAX_EVENTS 64
+
+typedef enum {
+  WATCH_FD,
+  WATCH_TIMER,
+  WATCH_WAKEUP
+} WatchKind;
+
+struct WrtLoopWatch {
+  WrtLoop* loop;
+  WatchKind kind;
+  int fd;
+  bool removed;
+  bool spent;
+  WrtLoopFdFn fdFn;
+  WrtLoopFn fn;
+  void* data;
+  uint64_t interval;
+#if !defined(WRT_LOOP_EPOLL)
+  uint64_t deadline;
+  volatile int signalled;
+#endif
+  WrtLoopWatch* next;
+};
+
+struct WrtLoop {
+  WrenVM* vm;
+  int epfd;
+  int numActive;
+  int dispatching;
+  bool stopped;
+  WrtLoopWatch* watches;
+  // One-shot timers that fired, kept until they are removed
+  WrtLoopWatch* spent;
+  WrtLoopWatch* graveyard;
+};
+
+static WrtLoopWatch* new_watch(WrtLoop* loop, WatchKind kind, int fd, void* data){
+  WrtLoopWatch* watch = calloc(1, sizeof(WrtLoopWatch));
+  watch->loop = loop;
+  watch->kind = kind;
+  watch->fd = fd;
+  watch->data = data;
+  return watch;
+}
+
+static void link_watch(WrtLoop* loop, WrtLoopWatch* watch){
+  watch->next = loop->watches;
+  loop->watches = watch;
+  loop->numActive++;
+}
+
+static void unlink_watch(WrtLoopWatch** list, WrtLoopWatch* watch){
+  WrtLoopWatch** current = list;
+  while(*current != NULL){
+    if(*current == watch){
+      *current = watch->next;
+      return;
+    }
+    current = &(*current)->next;
+  }
+}
+
+static void stop_watching(WrtLoop* loop, WrtLoopWatch* watch){
+  unlink_watch(&loop->watches, watch);
+  loop->numActive--;
+#if defined(WRT_LOOP_EPOLL)
+  epoll_ctl(loop->epfd, EPOLL_CTL_DEL, watch->fd, NULL);
+#endif
+}
+
+static void release_watch(WrtLoopWatch* watch){
+#if defined(WRT_LOOP_EPOLL)
+  // Timers and wakeups own their descriptor, fd watches borrow it from the caller
+  if(watch->kind != WATCH_FD){
+    close(watch->fd);
+  }
+#endif
+  free(watch);
+}
+
+bool wrt_loop_alive(WrtLoop* loop){
+  return loop->numActive > 0;
+}
+
+bool wrt_loop_take_stop(WrtLoop* loop){
+  bool stopped = loop->stopped;
+  loop->stopped = false;
+  return stopped;
+}
+
+void wrt_loop_request_stop(WrtLoop* loop){
+  loop->stopped = true;
+}
+
+void wrt_loop_remove_watch(WrtLoop* loop, WrtLoopWatch* watch){
+  if(watch == NULL || watch->removed) return;
+  watch->removed = true;
+  if(watch->spent){
+    unlink_watch(&loop->spent, watch);
+  } else {
+    stop_watching(loop, watch);
+  }
+  // Events for this watch may still be pending in the batch being dispatched
+  if(loop->dispatching > 0){
+    watch->next = loop->graveyard;
+    loop->graveyard = watch;
+  } else {
+    release_watch(watch);
+  }
+}
+
+static void dispatch(WrtLoop* loop, WrtLoopWatch* watch, int events){
+  if(watch->removed) return;
+  switch(watch->kind){
+    case WATCH_FD:
+      watch->fdFn(loop->vm, watch->fd, events, watch->data);
+      break;
+    case WATCH_TIMER:
+      watch->fn(loop->vm, watch->data);
+      // The caller still holds the handle, it stays valid until removed
+      if(watch->interval == 0 && !watch->removed){
+        stop_watching(loop, watch);
+        watch->spent = true;
+        watch->next = loop->spent;
+        loop->spent = watch;
+      }
+      break;
+    case WATCH_WAKEUP:
+      watch->fn(loop->vm, watch->data);
+      break;
+  }
+}
+
+static void bury_removed(WrtLoop* loop){
+  if(loop->dispatching > 0) return;
+  while(loop->graveyard != NULL){
+    WrtLoopWatch* watch = loop->graveyard;
+    loop->graveyard = watch->next;
+    release_watch(watch);
+  }
+}
+
+void wrt_loop_free(WrtLoop* loop){
+  while(loop->watches != NULL){
+    wrt_loop_remove_watch(loop, loop->watches);
+  }
+  while(loop->spent != NULL){
+    wrt_loop_remove_watch(loop, loop->spent);
+  }
+  bury_removed(loop);
+#if defined(WRT_LOOP_EPOLL)
+  close(loop->epfd);
+#endif
+  free(loop);
+}
+
+void wrt_loop_free_after_fork(WrtLoop* loop){
+  // The epoll instance is shared with the parent process, unregistering
+  // anything from it here would also remove the parent's watches
+  while(loop->watches != NULL){
+    WrtLoopWatch* watch = loop->watches;
+    loop->watches = watch->next;
+    release_watch(watch);
+  }
+  while(loop->spent != NULL){
+    WrtLoopWatch* watch = loop->spent;
+    loop->spent = watch->next;
+    release_watch(watch);
+  }
+  bury_removed(loop);
+#if defined(WRT_LOOP_EPOLL)
+  close(loop->epfd);
+#endif
+  free(loop);
+}
+
+#if defined(WRT_LOOP_EPOLL)
+
+WrtLoop* wrt_loop_new(WrenVM* vm){
+  int epfd = epoll_create1(EPOLL_CLOEXEC);
+  if(epfd < 0){
+    WRT_ERROR("Could not create event loop: %s", strerror(errno));
+    return NULL;
+  }
+  WrtLoop* loop = calloc(1, sizeof(WrtLoop));
+  loop->vm = vm;
+  loop->epfd = epfd;
+  return loop;
+}
+
+static bool add_to_epoll(WrtLoop* loop, WrtLoopWatch* watch, uint32_t events){
+  struct epoll_event ev = {0};
+  ev.events = events;
+  ev.data.ptr = watch;
+  if(epoll_ctl(loop->epfd, EPOLL_CTL_ADD, watch->fd, &ev) != 0){
+    WRT_ERROR("Could not watch fd %i: %s", watch->fd, strerror(errno));
+    return false;
+  }
+  link_watch(loop, watch);
+  return true;
+}
+
+WrtLoopWatch* wrt_loop_new_fd_watch(WrtLoop* loop, int fd, int events, WrtLoopFdFn fn, void* data){
+  WrtLoopWatch* watch = new_watch(loop, WATCH_FD, fd, data);
+  watch->fdFn = fn;
+  uint32_t mask = 0;
+  if(events & WRT_LOOP_READABLE) mask |= EPOLLIN;
+  if(events & WRT_LOOP_WRITABLE) mask |= EPOLLOUT;
+  if(!add_to_epoll(loop, watch, mask)){
+    free(watch);
+    return NULL;
+  }
+  return watch;
+}
+
+static void set_timespec(struct timespec* ts, uint64_t us){
+  ts->tv_sec = us / 1000000;
+  ts->tv_nsec = (us % 1000000) * 1000;
+}
+
+WrtLoopWatch* wrt_loop_new_timer(WrtLoop* loop, uint64_t delayUs, uint64_t intervalUs, WrtLoopFn fn, void* data){
+  int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if(fd < 0) return NULL;
+  struct itimerspec spec = {0};
+  // A zero it_value would disarm the timer, fire on the next iteration instead
+  set_timespec(&spec.it_value, delayUs);
+  if(delayUs == 0) spec.it_value.tv_nsec = 1;
+  set_timespec(&spec.it_interval, intervalUs);
+  timerfd_settime(fd, 0, &spec, NULL);
+
+  WrtLoopWatch* watch = new_watch(loop, WATCH_TIMER, fd, data);
+  watch->fn = fn;
+  watch->interval = intervalUs;
+  if(!add_to_epoll(loop, watch, EPOLLIN)){
+    release_watch(watch);
+    return NULL;
+  }
+  return watch;
+}
+
+WrtLoopWatch* wrt_loop_new_wakeup(WrtLoop* loop, WrtLoopFn fn, void* data){
+  int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if(fd < 0) return NULL;
+  WrtLoopWatch* watch = new_watch(loop, WATCH_WAKEUP, fd, data);
+  watch->fn = fn;
+  if(!add_to_epoll(loop, watch, EPOLLIN)){
+    release_watch(watch);
+    return NULL;
+  }
+  return watch;
+}
+
+void wrt_loop_signal_wakeup(WrtLoopWatch* wakeup){
+  uint64_t one = 1;
+  ssize_t written = write(wakeup->fd, &one, sizeof(one));
+  (void)written;
+}
+
+int wrt_loop_run_once(WrtLoop* loop, int64_t timeoutUs){
+  struct epoll_event events[MAX_EVENTS];
+  int timeout = timeoutUs < 0 ? -1 : (int)((timeoutUs + 999) / 1000);
+  int count = epoll_wait(loop->epfd, events, MAX_EVENTS, timeout);
+  if(count <= 0) return 0;
+
+  loop->dispatching++;
+  for (int i = 0; i < count; i++)
+  {
+    WrtLoopWatch* watch = (WrtLoopWatch*)events[i].data.ptr;
+    int ready = 0;
+    if(watch->kind != WATCH_FD){
+      // Drain the timer expiration count / eventfd counter so the fd is not ready again
+      uint64_t counter;
+      ssize_t got = read(watch->fd, &counter, sizeof(counter));
+      if(got != sizeof(counter)) continue;
+    } else {
+      if(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) ready |= WRT_LOOP_READABLE;
+      if(events[i].events & (EPOLLOUT | EPOLLERR)) ready |= WRT_LOOP_WRITABLE;
+    }
+    dispatch(loop, watch, ready);
+  }
+  loop->dispatching--;
+  bury_removed(loop);
+  return count;
+}
+
+#else
+
+// Portable fallback without fd readiness: timers and wakeups are checked
+// against the monotonic clock and the loop sleeps until the next deadline.
+
+#define WAKEUP_POLL_US 1000
+
+WrtLoop* wrt_loop_new(WrenVM* vm){
+  WrtLoop* loop = calloc(1, sizeof(WrtLoop));
+  loop->vm = vm;
+  loop->epfd = -1;
+  return loop;
+}
+
+WrtLoopWatch* wrt_loop_new_fd_watch(WrtLoop* loop, int fd, int events, WrtLoopFdFn fn, void* data){
+  WRT_ERROR("fd watches are not supported by platform");
+  return NULL;
+}
+
+WrtLoopWatch* wrt_loop_new_timer(WrtLoop* loop, uint64_t delayUs, uint64_t intervalUs, WrtLoopFn fn, void* data){
+  WrtLoopWatch* watch = new_watch(loop, WATCH_TIMER, -1, data);
+  watch->fn = fn;
+  watch->interval = intervalUs;
+  watch->deadline = wrt_clock_us() + delayUs;
+  link_watch(loop, watch);
+  return watch;
+}
+
+WrtLoopWatch* wrt_loop_new_wakeup(WrtLoop* loop, WrtLoopFn fn, void* data){
+  WrtLoopWatch* watch = new_watch(loop, WATCH_WAKEUP, -1, data);
+  watch->fn = fn;
+  link_watch(loop, watch);
+  return watch;
+}
+
+void wrt_loop_signal_wakeup(WrtLoopWatch* wakeup){
+  wakeup->signalled = 1;
+}
+
+int wrt_loop_run_once(WrtLoop* loop, int64_t timeoutUs){
+  int count = 0;
+  uint64_t now = wrt_clock_us();
+  int64_t wait = timeoutUs;
+  for(WrtLoopWatch* watch = loop->watches; watch != NULL; watch = watch->next){
+    int64_t until = watch->kind == WATCH_TIMER
+      ? (watch->deadline > now ? (int64_t)(watch->deadline - now) : 0)
+      : WAKEUP_POLL_US;
+    if(wait < 0 || until < wait) wait = until;
+  }
+  if(wait > 0) wrt_sleep_us((uint64_t)wait);
+
+  now = wrt_clock_us();
+  loop->dispatching++;
+  WrtLoopWatch* next;
+  for(WrtLoopWatch* watch = loop->watches; watch != NULL; watch = next){
+    next = watch->next;
+    if(watch->kind == WATCH_TIMER && watch->deadline <= now){
+      watch->deadline = now + watch->interval;
+      dispatch(loop, watch, 0);
+      count++;
+    } else if(watch->kind == WATCH_WAKEUP && watch->signalled){
+      watch->signalled = 0;
+      dispatch(loop, watch, 0);
+      count++;
+    }
+  }
+  loop->dispatching--;
+  bury_removed(loop);
+  return count;
+}
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef WRT_EVENT_LOOP_H
+#define WRT_EVENT_LOOP_H
+
+#include <stdint.h>
+#include <wren_runtime.h>
+
+typedef struct WrtLoop WrtLoop;
+
+WrtLoop* wrt_loop_new(WrenVM* vm);
+void wrt_loop_free(WrtLoop* loop);
+// Drops a loop inherited through fork() without touching the parent's watches
+void wrt_loop_free_after_fork(WrtLoop* loop);
+bool wrt_loop_alive(WrtLoop* loop);
+// Dispatches ready watches. Blocks for at most timeoutUs microseconds,
+// forever if timeoutUs is negative. Returns the number of ready watches.
+int wrt_loop_run_once(WrtLoop* loop, int64_t timeoutUs);
+
+WrtLoopWatch* wrt_loop_new_fd_watch(WrtLoop* loop, int fd, int events, WrtLoopFdFn fn, void* data);
+WrtLoopWatch* wrt_loop_new_timer(WrtLoop* loop, uint64_t delayUs, uint64_t intervalUs, WrtLoopFn fn, void* data);
+WrtLoopWatch* wrt_loop_new_wakeup(WrtLoop* loop, WrtLoopFn fn, void* data);
+void wrt_loop_remove_watch(WrtLoop* loop, WrtLoopWatch* watch);
+void wrt_loop_signal_wakeup(WrtLoopWatch* wakeup);
+void wrt_loop_request_stop(WrtLoop* loop);
+bool wrt_loop_take_stop(WrtLoop* loop);
+
+#endif
@@ -0,0 +1,92 @@
+#include "gc.h"
+#include "os_call.h"
+
+#define MIN_GROWTH_PERCENT 25
+#define MAX_GROWTH_PERCENT 400
+// Share of wall time the VM may spend collecting before the heap grows
+#define TARGET_GC_SHARE 0.05
+// Above this most of the heap is live and collecting again soon is wasted
+#define HIGH_SURVIVAL 0.8
+#define LOW_SURVIVAL 0.3
+// Idle collections start once the heap got this far towards the next one
+#define IDLE_PRESSURE_PERCENT 50
+
+static int clamp_growth(int growth){
+  if(growth < MIN_GROWTH_PERCENT) return MIN_GROWTH_PERCENT;
+  if(growth > MAX_GROWTH_PERCENT) return MAX_GROWTH_PERCENT;
+  return growth;
+}
+
+void wrt_gc_configure(WrtGC* gc, const WrtVMConfig* vmConfig, WrenConfiguration* config){
+  if(vmConfig->initialHeapSize > 0) config->initialHeapSize = vmConfig->initialHeapSize;
+  if(vmConfig->minHeapSize > 0) config->minHeapSize = vmConfig->minHeapSize;
+  if(vmConfig->heapGrowthPercent > 0) config->heapGrowthPercent = vmConfig->heapGrowthPercent;
+
+  // Without adaptive mode these only estimate where Wren collects next
+  gc->adaptive = vmConfig->adaptiveHeap;
+  gc->idleBudgetUs = vmConfig->idleGCBudgetUs;
+  gc->nextCollection = config->initialHeapSize;
+  gc->minHeapSize = config->minHeapSize;
+  gc->growthPercent = config->heapGrowthPercent;
+  gc->lastCollectionEnd = wrt_clock_us();
+  if(!gc->adaptive) return;
+
+  gc->growthPercent = clamp_growth(config->heapGrowthPercent);
+  // Wren's own trigger stays as a backstop. Its thresholds are moved far
+  // enough out that the runtime collects first.
+  config->initialHeapSize *= 2;
+  config->minHeapSize *= 2;
+  config->heapGrowthPercent = MAX_GROWTH_PERCENT * 2 + 100;
+}
+
+// Collections that take a large share of the time or free little make the
+// heap grow faster, cheap ones that free most of it let it shrink again
+static void adapt_growth(WrtGC* gc, size_t before, size_t after, uint64_t start, uint64_t end){
+  uint64_t pause = end - start;
+  uint64_t mutator = start - gc->lastCollectionEnd;
+  double gcShare = (double)pause / (double)(pause + mutator + 1);
+  double survival = before > 0 ? (double)after / (double)before : 1.0;
+
+  int growth = gc->growthPercent;
+  if(gcShare > TARGET_GC_SHARE || survival > HIGH_SURVIVAL){
+    growth += growth / 2;
+  } else if(gcShare < TARGET_GC_SHARE / 4 && survival < LOW_SURVIVAL){
+    growth -= growth / 4;
+  }
+  gc->growthPercent = clamp_growth(growth);
+}
+
+void wrt_gc_collect(WrtGC* gc, const size_t* heapBytes){
+  if(gc->vm == NULL || gc->collecting) return;
+  gc->collecting = true;
+  size_t before = *heapBytes;
+  uint64_t start = wrt_clock_us();
+  wrenCollectGarbage(gc->vm);
+  uint64_t end = wrt_clock_us();
+  size_t after = *heapBytes;
+  gc->collecting = false;
+
+  gc->stats.collections++;
+  gc->stats.lastPauseUs = end - start;
+  gc->stats.totalPauseUs += end - start;
+  gc->stats.lastSurvivedBytes = after;
+  if(gc->adaptive){
+    adapt_growth(gc, before, after, start, end);
+  }
+  size_t next = after + after / 100 * gc->growthPercent;
+  gc->nextCollection = next > gc->minHeapSize ? next : gc->minHeapSize;
+  gc->lastHeapBefore = before;
+  gc->lastCollectionEnd = end;
+}
+
+bool wrt_gc_idle_due(const WrtGC* gc, size_t heapBytes){
+  if(gc->idleBudgetUs == 0 || gc->vm == NULL || gc->collecting) return false;
+  size_t live = gc->stats.lastSurvivedBytes;
+  if(heapBytes <= live) return false;
+  size_t headroom = gc->nextCollection > live ? gc->nextCollection - live : 0;
+  if((heapBytes - live) < headroom / 100 * IDLE_PRESSURE_PERCENT) return false;
+  // The pause grows with the heap, scale the last one by how much it grew
+  if(gc->lastHeapBefore == 0) return true;
+  double estimate = (double)gc->stats.lastPauseUs * (double)heapBytes / (double)gc->lastHeapBefore;
+  return estimate <= (double)gc->idleBudgetUs;
+}
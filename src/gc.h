@@ -0,0 +1,37 @@
+#ifndef WRT_GC_H
+#define WRT_GC_H
+
+#include <stdint.h>
+#include <wren.h>
+#include <wren_runtime.h>
+
+// Garbage collection state of a VM. In adaptive mode the runtime starts
+// collections from the allocator once the heap outgrows nextCollection and
+// retunes growthPercent after every collection.
+typedef struct {
+  // Set once wrenNewVM returned, cleared before wrenFreeVM
+  WrenVM* vm;
+  bool adaptive;
+  bool collecting;
+  size_t nextCollection;
+  size_t minHeapSize;
+  int growthPercent;
+  uint64_t lastCollectionEnd;
+  size_t lastHeapBefore;
+  // Longest pause an idle-time collection may take, 0 disables them
+  uint64_t idleBudgetUs;
+  WrtGCStats stats;
+} WrtGC;
+
+void wrt_gc_configure(WrtGC* gc, const WrtVMConfig* vmConfig, WrenConfiguration* config);
+// Runs a measured collection, heapBytes is read before and after it
+void wrt_gc_collect(WrtGC* gc, const size_t* heapBytes);
+// True when the heap is far enough on its way to the next collection and the
+// pause it would take is expected to fit the idle budget
+bool wrt_gc_idle_due(const WrtGC* gc, size_t heapBytes);
+
+static inline bool wrt_gc_due(const WrtGC* gc, size_t heapBytes){
+  return gc->adaptive && heapBytes > gc->nextCollection && gc->vm != NULL && !gc->collecting;
+}
+
+#endif
@@ -0,0 +1,95 @@
+#include <stdbool.h>
+#include <string.h>
+
+#include "imports.h"
+
+static bool is_name_char(char c){
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+static const char* skip_block_comment(const char* p){
+  // Wren block comments nest
+  int depth = 1;
+  while(*p && depth > 0){
+    if(p[0] == '/' && p[1] == '*'){
+      depth++;
+      p += 2;
+    } else if(p[0] == '*' && p[1] == '/'){
+      depth--;
+      p += 2;
+    } else {
+      p++;
+    }
+  }
+  return p;
+}
+
+static const char* skip_string(const char* p);
+
+// Skips an interpolated expression up to its closing parenthesis
+static const char* skip_interpolation(const char* p){
+  int depth = 1;
+  while(*p && depth > 0){
+    if(*p == '"'){
+      p = skip_string(p + 1);
+    } else {
+      if(*p == '(') depth++;
+      if(*p == ')') depth--;
+      p++;
+    }
+  }
+  return p;
+}
+
+// p is just after the opening quote
+static const char* skip_string(const char* p){
+  if(p[0] == '"' && p[1] == '"'){
+    // Raw string, no escapes or interpolation
+    const char* end = strstr(p + 2, "\"\"\"");
+    return end != NULL ? end + 3 : p + strlen(p);
+  }
+  while(*p && *p != '"'){
+    if(*p == '\\' && p[1] != 0){
+      p += 2;
+    } else if(*p == '%' && p[1] == '('){
+      p = skip_interpolation(p + 2);
+    } else {
+      p++;
+    }
+  }
+  return *p ? p + 1 : p;
+}
+
+// p is just after the import keyword
+static const char* scan_import(const char* p, WrtImportFn fn, void* data){
+  while(*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') p++;
+  if(*p != '"') return p;
+  const char* start = ++p;
+  while(*p && *p != '"' && *p != '\\' && *p != '%' && *p != '\n') p++;
+  if(*p == '"'){
+    fn(start, (size_t)(p - start), data);
+    return p + 1;
+  }
+  return skip_string(start);
+}
+
+void wrt_scan_imports(const char* source, WrtImportFn fn, void* data){
+  const char* p = source;
+  while(*p){
+    if(p[0] == '/' && p[1] == '/'){
+      while(*p && *p != '\n') p++;
+    } else if(p[0] == '/' && p[1] == '*'){
+      p = skip_block_comment(p + 2);
+    } else if(*p == '"'){
+      p = skip_string(p + 1);
+    } else if(is_name_char(*p)){
+      const char* start = p;
+      while(is_name_char(*p)) p++;
+      if(p - start == 6 && memcmp(start, "import", 6) == 0){
+        p = scan_import(p, fn, data);
+      }
+    } else {
+      p++;
+    }
+  }
+}
@@ -0,0 +1,14 @@
+#ifndef WRT_IMPORTS_H
+#define WRT_IMPORTS_H
+
+#include <stddef.h>
+
+typedef void (*WrtImportFn)(const char* name, size_t length, void* data);
+
+// Calls fn with the module name of every import statement in source, in
+// order. Comments and strings are skipped, names with escapes or
+// interpolation are not reported. Imports in code that never runs are
+// reported too, callers may only use this as a hint.
+void wrt_scan_imports(const char* source, WrtImportFn fn, void* data);
+
+#endif
@@ -1,20 +1,209 @@
 #ifndef wren_runtime_h
 #define wren_runtime_h
 
+#include <stdint.h>
 #include <wren.h>
 
 typedef WrenForeignMethodFn (*WrtPluginInitFunc)(int handle);
 
+#define WRT_LOOP_READABLE 1
+#define WRT_LOOP_WRITABLE 2
+
+typedef struct WrtLoopWatch WrtLoopWatch;
+typedef struct WrtVMPool WrtVMPool;
+typedef void (*WrtLoopFn)(WrenVM* vm, void* data);
+typedef void (*WrtLoopFdFn)(WrenVM* vm, int fd, int events, void* data);
+typedef int (*WrtWorkerFn)(WrenVM* vm, int index, void* data);
+typedef enum {
+  WRT_LOG_TRACE,
+  WRT_LOG_DEBUG,
+  WRT_LOG_INFO,
+  WRT_LOG_WARN,
+  WRT_LOG_ERROR,
+  WRT_LOG_OFF
+} WrtLogLevel;
+
+typedef void (*WrtOutputFn)(WrenVM* vm, const char* text, size_t length, void* data);
+
+// A foreign method with its precomputed FNV-1a name hash, see wren_runtime.hpp
+typedef struct {
+  uint64_t hash;
+  const char* name;
+  WrenForeignMethodFn fn;
+} WrtMethodBinding;
+
+// A module compiled into the binary, see wrt_embed_modules in tools
+typedef struct {
+  const char* name;
+  const char* source;
+} WrtEmbeddedModule;
+
+typedef enum {
+  // Modules added with wrt_add_memory_module or wrt_add_embedded_modules
+  WRT_SOURCE_MEMORY,
+  // A file written by wrt_bundle
+  WRT_SOURCE_BUNDLE,
+  // A module root whose files are all mapped
+  WRT_SOURCE_MAPPED_DIRECTORY,
+  // A module root on the host filesystem, small files are copied
+  WRT_SOURCE_DIRECTORY
+} WrtModuleSourceKind;
+
+// Default priorities, wrt_init adds the memory source and its module root
+#define WRT_PRIORITY_MEMORY 300
+#define WRT_PRIORITY_BUNDLE 200
+#define WRT_PRIORITY_ROOT 0
+
+typedef enum {
+  // Every allocation goes to the system malloc
+  WRT_ALLOCATOR_SYSTEM,
+  // Per-VM size-class slabs, released all at once when the VM is freed
+  WRT_ALLOCATOR_ARENA
+} WrtAllocator;
+
+typedef struct {
+  bool isMain;
+  WrtAllocator allocator;
+  // Bytes the VM's heap may hold, 0 for no limit. See wrt_set_memory_quota.
+  size_t memoryQuota;
+  // Handed to Wren's configuration, 0 keeps Wren's default
+  size_t initialHeapSize;
+  size_t minHeapSize;
+  int heapGrowthPercent;
+  // The runtime schedules collections itself and tunes the growth percent
+  // from the pause time and survival rate of each collection
+  bool adaptiveHeap;
+  // The runtime loop collects while it would otherwise wait, as long as the
+  // pause is expected to stay within this budget. 0 disables it.
+  uint64_t idleGCBudgetUs;
+  // System.print output is collected up to a newline or this many bytes,
+  // 0 writes every fragment straight through
+  size_t outputBufferSize;
+} WrtVMConfig;
+
+typedef struct {
+  size_t current;
+  size_t peak;
+  size_t quota;
+} WrtMemoryStats;
+
+// Only collections started by the runtime are counted, Wren's own ones are
+// not observable from outside the VM
+typedef struct {
+  uint64_t collections;
+  uint64_t totalPauseUs;
+  uint64_t lastPauseUs;
+  size_t lastSurvivedBytes;
+  int heapGrowthPercent;
+} WrtGCStats;
+
 void wrt_init(const char* root);
+void wrt_init_vm_config(WrtVMConfig* config);
 WrenVM* wrt_new_wren_vm(bool isMain);
+WrenVM* wrt_new_wren_vm_with_config(const WrtVMConfig* config);
+void wrt_free_wren_vm(WrenVM* vm);
 void wrt_bind_class(const char* name, WrenForeignMethodFn allocator, WrenFinalizerFn finalizer);
 void wrt_bind_method(const char* name, WrenForeignMethodFn func);
+void wrt_bind_methods(const WrtMethodBinding* methods, int count);
+// Bindings registered since the last seal are looked up under a lock.
+// Creating a VM seals them, this seals a batch of registrations earlier.
+void wrt_seal_bindings();
 void wrt_set_plugin_data(WrenVM* vm, int handle, void* value);
 void* wrt_get_plugin_data(WrenVM* vm, int handle);
-void wrt_wren_update_callback(WrenForeignMethodFn fn);
+void wrt_wren_update_callback(WrenVM* vm, WrenForeignMethodFn fn);
 void wrt_call_update_callbacks(WrenVM* vm);
 void wrt_register_plugin(const char* name, WrtPluginInitFunc initfunc);
 void wrt_run_main(WrenVM* vm, const char* module);
+// Runtime diagnostics go to stderr from a background thread. Levels below
+// the compile-time WRT_LOG_LEVEL can not be enabled here.
+void wrt_set_log_level(WrtLogLevel level);
+// Waits until the messages logged so far are written
+void wrt_flush_log();
+// VM output goes to stdout unless redirected to another fd or a callback.
+// Passing a NULL callback switches back to the fd.
+void wrt_set_output_fd(WrenVM* vm, int fd);
+void wrt_set_output_callback(WrenVM* vm, WrtOutputFn fn, void* data);
+void wrt_flush_output(WrenVM* vm);
+// Calls signature on a module level variable. The receiver and call handles
+// are looked up once per VM and cached: the receiver is a snapshot, a
+// variable that is reassigned later keeps its old receiver, which stays
+// reachable until the VM is freed or released to its pool. Each format
+// character consumes one argument:
+//   d double, i int, b bool (int), s string, h WrenHandle*, n null (none)
+// The return value is left in slot 0.
+WrenInterpretResult wrt_call(WrenVM* vm, const char* module, const char* variable, const char* signature, const char* format, ...);
+// wrenInterpret that enforces the VM's memory quota, see wrt_set_memory_quota
+WrenInterpretResult wrt_interpret(WrenVM* vm, const char* module, const char* source);
+WrenInterpretResult wrt_import_modules(WrenVM* vm, const char* importer, const char** modules, int numModules);
+void wrt_get_memory_stats(WrenVM* vm, WrtMemoryStats* stats);
+// An allocation that takes a VM over its quota first collects. A VM that is
+// still over it may use a reserve of an eighth of the quota, at least 64 KiB,
+// so it can be stopped cleanly: wrt_interpret and wrt_call refuse to run it,
+// the update loop ends and wrt_check_memory_quota aborts the calling fiber.
+// Code that uses up the reserve as well is stopped right inside Wren and
+// wrt_interpret or wrt_call returns a runtime error. Such a VM can only be
+// freed, foreign methods on the stack at that point are left without
+// unwinding. Code run by calling wrenInterpret or wrenCall directly is not
+// stopped inside Wren.
+void wrt_set_memory_quota(WrenVM* vm, size_t bytes);
+// For foreign methods: aborts the current fiber and returns false when the
+// VM is still over its quota after a collection
+bool wrt_check_memory_quota(WrenVM* vm);
+void wrt_collect_garbage(WrenVM* vm);
+void wrt_get_gc_stats(WrenVM* vm, WrtGCStats* stats);
+void wrt_set_idle_gc_budget(WrenVM* vm, uint64_t budgetUs);
+// Both apply to the shared module source cache and to the cache of where
+// installed modules were found
+void wrt_set_module_cache_interval(uint64_t intervalUs);
+void wrt_clear_module_cache();
+// Installed modules are searched in these sources, highest priority first
+// and in the order they were added on equal priority. path is the bundle
+// file or the module root and the source is refused without it, it is NULL
+// for the memory source. There is only one memory source, adding it again
+// changes its priority. Sources are meant to be added at startup, they stay
+// for the rest of the process.
+bool wrt_add_module_source(WrtModuleSourceKind kind, const char* path, int priority);
+// Adds a bundle with WRT_PRIORITY_BUNDLE
+bool wrt_mount_bundle(const char* path);
+// Registers a table of embedded modules sorted by name with the memory
+// source. The table has to stay valid for the rest of the process. It may
+// be called before wrt_init, sources generated by wrt_embed_modules do so
+// from a static constructor.
+void wrt_add_embedded_modules(const WrtEmbeddedModule* modules, int count);
+// Copies source into the memory source, a name can only be added once
+void wrt_add_memory_module(const char* name, const char* source);
+// Loaded sources are scanned for import statements and the imported modules,
+// including their binary plugins, are read on up to this many threads before
+// the compiler asks for them. 0, the default, turns this off.
+void wrt_set_prefetch_threads(int threads);
+
+// Pool of VMs that already imported the given modules, all created with
+// config or the defaults of wrt_init_vm_config when it is NULL. Released
+// VMs get the plugin data of the warm modules, their event loop, wrt_call
+// cache, memory quota, idle GC budget and statistics reset before they are
+// handed out again.
+WrtVMPool* wrt_new_vm_pool(int size, const WrtVMConfig* config, const char** modules, int numModules);
+WrenVM* wrt_vm_pool_acquire(WrtVMPool* pool);
+void wrt_vm_pool_release(WrtVMPool* pool, WrenVM* vm);
+void wrt_free_vm_pool(WrtVMPool* pool);
+
+// Forks a worker process that inherits vm with every module and plugin it
+// imported, copy-on-write. Returns the worker's pid, the worker runs
+// worker(vm, index, data) on an empty event loop and exits with its result.
+int wrt_zygote_fork(WrenVM* vm, WrtWorkerFn worker, int index, void* data);
+
+// Event loop, driven by wrt_call_update_callbacks until no watches remain.
+// Callbacks registered with wrt_wren_update_callback are polled every
+// millisecond while it runs. A one-shot timer (intervalUs 0) stops keeping
+// the loop alive once it fired, but its handle stays valid and its memory
+// is held until it is passed to wrt_loop_remove or the VM is freed or
+// released to its pool.
+WrtLoopWatch* wrt_loop_watch_fd(WrenVM* vm, int fd, int events, WrtLoopFdFn fn, void* data);
+WrtLoopWatch* wrt_loop_add_timer(WrenVM* vm, uint64_t delayUs, uint64_t intervalUs, WrtLoopFn fn, void* data);
+WrtLoopWatch* wrt_loop_add_wakeup(WrenVM* vm, WrtLoopFn fn, void* data);
+void wrt_loop_signal(WrtLoopWatch* wakeup);
+void wrt_loop_remove(WrenVM* vm, WrtLoopWatch* watch);
+void wrt_loop_stop(WrenVM* vm);
 
 #define WREN_METHOD(NAME) static void NAME(WrenVM* vm)
 #define WREN_CONSTRUCTOR(NAME) static void NAME(WrenVM* vm)
@@ -0,0 +1,224 @@
+#ifndef wren_runtime_hpp
+#define wren_runtime_hpp
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+extern "C" {
+#include <wren_runtime.h>
+#include <wrt_hash.h>
+}
+
+namespace wrt {
+
+// Same FNV-1a hash the runtime uses for "module.Class.signature" keys, so
+// tables built here are inserted without hashing anything at startup.
+constexpr uint64_t hash_name(std::string_view name){
+  uint64_t hash = WRT_FNV_OFFSET;
+  for(char c : name){
+    hash = WRT_FNV_STEP(hash, c);
+  }
+  return hash;
+}
+
+constexpr WrtMethodBinding method(const char* name, WrenForeignMethodFn fn){
+  return WrtMethodBinding{ hash_name(name), name, fn };
+}
+
+// Builds a binding table sorted by hash at compile time:
+//
+//   static constexpr auto bindings = wrt::binding_table(
+//     wrt::method("mod.Class.add(_,_)", add),
+//     wrt::method("mod.Class.sub(_,_)", sub));
+//   static_assert(wrt::has_unique_names(bindings));
+//   wrt::bind(bindings);
+template<typename... Bindings>
+constexpr std::array<WrtMethodBinding, sizeof...(Bindings)> binding_table(Bindings... bindings){
+  std::array<WrtMethodBinding, sizeof...(Bindings)> table{ bindings... };
+  for(std::size_t i = 1; i < table.size(); i++){
+    WrtMethodBinding current = table[i];
+    std::size_t j = i;
+    for(; j > 0 && table[j - 1].hash > current.hash; j--){
+      table[j] = table[j - 1];
+    }
+    table[j] = current;
+  }
+  return table;
+}
+
+template<std::size_t N>
+constexpr bool has_unique_names(const std::array<WrtMethodBinding, N>& table){
+  // Sorted by hash, so duplicates are always neighbours
+  for(std::size_t i = 1; i < N; i++){
+    if(table[i].hash == table[i - 1].hash
+      && std::string_view(table[i].name) == std::string_view(table[i - 1].name)){
+      return false;
+    }
+  }
+  return true;
+}
+
+template<std::size_t N>
+inline void bind(const std::array<WrtMethodBinding, N>& table){
+  wrt_bind_methods(table.data(), static_cast<int>(N));
+}
+
+namespace detail {
+
+// Slot marshaling per C++ type. Numbers go through doubles, strings are
+// handed out as views over the bytes Wren owns, pointers are foreign data.
+// Arguments are checked against the Wren type named by typeName before the
+// function is called.
+template<typename T>
+struct slot {
+  static_assert(std::is_arithmetic_v<T>, "unsupported foreign method type");
+  static constexpr const char* typeName = "Num";
+  static bool check(WrenVM* vm, int index){ return wrenGetSlotType(vm, index) == WREN_TYPE_NUM; }
+  static T get(WrenVM* vm, int index){ return static_cast<T>(wrenGetSlotDouble(vm, index)); }
+  static void set(WrenVM* vm, int index, T value){ wrenSetSlotDouble(vm, index, static_cast<double>(value)); }
+};
+
+template<>
+struct slot<bool> {
+  static constexpr const char* typeName = "Bool";
+  static bool check(WrenVM* vm, int index){ return wrenGetSlotType(vm, index) == WREN_TYPE_BOOL; }
+  static bool get(WrenVM* vm, int index){ return wrenGetSlotBool(vm, index); }
+  static void set(WrenVM* vm, int index, bool value){ wrenSetSlotBool(vm, index, value); }
+};
+
+template<>
+struct slot<std::string_view> {
+  static constexpr const char* typeName = "String";
+  static bool check(WrenVM* vm, int index){ return wrenGetSlotType(vm, index) == WREN_TYPE_STRING; }
+  static std::string_view get(WrenVM* vm, int index){
+    int length;
+    const char* bytes = wrenGetSlotBytes(vm, index, &length);
+    return std::string_view(bytes, static_cast<std::size_t>(length));
+  }
+  static void set(WrenVM* vm, int index, std::string_view value){ wrenSetSlotBytes(vm, index, value.data(), value.size()); }
+};
+
+template<>
+struct slot<const char*> {
+  static constexpr const char* typeName = "String";
+  static bool check(WrenVM* vm, int index){ return wrenGetSlotType(vm, index) == WREN_TYPE_STRING; }
+  static const char* get(WrenVM* vm, int index){ return wrenGetSlotString(vm, index); }
+  static void set(WrenVM* vm, int index, const char* value){ wrenSetSlotString(vm, index, value); }
+};
+
+template<>
+struct slot<WrenHandle*> {
+  // Any value can be held on to
+  static constexpr const char* typeName = "Object";
+  static bool check(WrenVM*, int){ return true; }
+  static WrenHandle* get(WrenVM* vm, int index){ return wrenGetSlotHandle(vm, index); }
+  static void set(WrenVM* vm, int index, WrenHandle* value){ wrenSetSlotHandle(vm, index, value); }
+};
+
+template<typename T>
+struct slot<T*> {
+  static constexpr const char* typeName = "foreign object";
+  static bool check(WrenVM* vm, int index){ return wrenGetSlotType(vm, index) == WREN_TYPE_FOREIGN; }
+  static T* get(WrenVM* vm, int index){ return static_cast<T*>(wrenGetSlotForeign(vm, index)); }
+};
+
+template<typename T>
+using bare = std::remove_cv_t<std::remove_reference_t<T>>;
+
+inline void abort_argument(WrenVM* vm, int index, const char* typeName){
+  char message[64];
+  std::snprintf(message, sizeof(message), "Argument %i must be a %s.", index, typeName);
+  wrenSetSlotString(vm, 0, message);
+  wrenAbortFiber(vm, 0);
+}
+
+template<auto Fn, typename R, typename... Args>
+struct invoker {
+  // A leading WrenVM* parameter receives the VM and consumes no slot
+  static constexpr bool takesVM = sizeof...(Args) > 0
+    && std::is_same_v<bare<std::tuple_element_t<0, std::tuple<Args..., void>>>, WrenVM*>;
+
+  template<std::size_t I>
+  using arg_type = bare<std::tuple_element_t<I, std::tuple<Args...>>>;
+
+  // Slot 0 holds the receiver, arguments start at slot 1
+  template<std::size_t I>
+  static constexpr int index = static_cast<int>(takesVM ? I : I + 1);
+
+  template<std::size_t I>
+  static bool check(WrenVM* vm){
+    if constexpr(takesVM && I == 0){
+      return true;
+    } else {
+      if(slot<arg_type<I>>::check(vm, index<I>)) return true;
+      abort_argument(vm, index<I>, slot<arg_type<I>>::typeName);
+      return false;
+    }
+  }
+
+  template<std::size_t I>
+  static arg_type<I> arg(WrenVM* vm){
+    if constexpr(takesVM && I == 0){
+      return vm;
+    } else {
+      return slot<arg_type<I>>::get(vm, index<I>);
+    }
+  }
+
+  template<std::size_t... I>
+  static void call(WrenVM* vm, std::index_sequence<I...>){
+    if(!(check<I>(vm) && ...)) return;
+    if constexpr(std::is_void_v<R>){
+      Fn(arg<I>(vm)...);
+    } else {
+      slot<bare<R>>::set(vm, 0, Fn(arg<I>(vm)...));
+    }
+  }
+
+  static void invoke(WrenVM* vm){
+    call(vm, std::index_sequence_for<Args...>{});
+  }
+};
+
+// Matched on the pointer type, noexcept is part of it
+template<auto Fn, typename F = decltype(Fn)>
+struct method;
+
+template<auto Fn, typename R, typename... Args>
+struct method<Fn, R (*)(Args...)> : invoker<Fn, R, Args...> {};
+
+template<auto Fn, typename R, typename... Args>
+struct method<Fn, R (*)(Args...) noexcept> : invoker<Fn, R, Args...> {};
+
+}
+
+// Turns a plain C++ function into a foreign method at compile time:
+//
+//   static double add(double a, double b){ return a + b; }
+//   wrt::bind_method<add>("mod.Math.add(_,_)");
+//
+// The wrapper is a straight sequence of slot type checks and reads, one call
+// and one slot write, nothing is allocated and strings are not copied. An
+// argument of the wrong type aborts the fiber without calling the function.
+template<auto Fn>
+constexpr WrenForeignMethodFn foreign = &detail::method<Fn>::invoke;
+
+template<auto Fn>
+inline void bind_method(const char* name){
+  wrt_bind_method(name, foreign<Fn>);
+}
+
+template<auto Fn>
+constexpr WrtMethodBinding method(const char* name){
+  return method(name, foreign<Fn>);
+}
+
+}
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef WRT_HASH_H
+#define WRT_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 64 bit FNV-1a, used for binding keys, bundle indexes and resolve cache
+// stamps. Bundle files and precomputed WrtMethodBinding hashes store its
+// values, so it can not change. The step is a macro so C++ can use it in
+// constant expressions.
+#define WRT_FNV_OFFSET 14695981039346656037ULL
+#define WRT_FNV_PRIME 1099511628211ULL
+#define WRT_FNV_STEP(hash, byte) (((hash) ^ (uint64_t)(unsigned char)(byte)) * WRT_FNV_PRIME)
+
+static inline uint64_t wrt_hash_string(uint64_t hash, const char* str){
+  for(; *str; str++){
+    hash = WRT_FNV_STEP(hash, *str);
+  }
+  return hash;
+}
+
+// Hashes the bytes of value from the least significant one up, independent
+// of byte order
+static inline uint64_t wrt_hash_u64(uint64_t hash, uint64_t value){
+  for (int i = 0; i < 8; i++)
+  {
+    hash = WRT_FNV_STEP(hash, value >> (i * 8));
+  }
+  return hash;
+}
+
+#endif
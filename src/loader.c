@@ -0,0 +1,182 @@
+#include <stdlib.h>
+#include <string.h>
+#include <cwalk.h>
+
+#include "loader.h"
+#include "bundle.h"
+#include "embedded.h"
+#include "resolve_cache.h"
+#include "modules.h"
+#include "mutex.h"
+#include "atomic.h"
+#include "log.h"
+
+typedef struct {
+  WrtModuleSourceKind kind;
+  int priority;
+  // Directory root, NULL for the other kinds
+  char* path;
+  WrtBundle* bundle;
+} ModuleSource;
+
+typedef struct SourceChain {
+  ModuleSource* sources;
+  int count;
+  const char** roots;
+  int numRoots;
+  // Kept reachable, see chain
+  const struct SourceChain* previous;
+} SourceChain;
+
+static MUTEX loaderMutex;
+// Changes publish a new chain. Replaced chains are not freed, lookups may
+// still walk them, sources are expected to be added at startup only.
+static SourceChain* chain = NULL;
+
+static const char* kindNames[] = { "memory", "bundle", "mapped directory", "directory" };
+
+void wrt_loader_init(void){
+  MUTEX_INIT(&loaderMutex);
+}
+
+void wrt_loader_before_fork(void){
+  MUTEX_LOCK(&loaderMutex);
+}
+
+void wrt_loader_after_fork(void){
+  MUTEX_UNLOCK(&loaderMutex);
+}
+
+static bool is_directory(WrtModuleSourceKind kind){
+  return kind == WRT_SOURCE_MAPPED_DIRECTORY || kind == WRT_SOURCE_DIRECTORY;
+}
+
+// Copies current with source inserted after every source of at least its
+// priority. There is only one memory source, adding it again moves it.
+static SourceChain* insert_source(const SourceChain* current, ModuleSource source){
+  int count = current != NULL ? current->count : 0;
+  SourceChain* next = calloc(1, sizeof(SourceChain));
+  next->previous = current;
+  next->sources = malloc((count + 1) * sizeof(ModuleSource));
+  next->roots = malloc((count + 1) * sizeof(const char*));
+  bool inserted = false;
+  for (int i = 0; i < count; i++)
+  {
+    const ModuleSource* existing = &current->sources[i];
+    if(source.kind == WRT_SOURCE_MEMORY && existing->kind == WRT_SOURCE_MEMORY) continue;
+    if(!inserted && existing->priority < source.priority){
+      next->sources[next->count++] = source;
+      inserted = true;
+    }
+    next->sources[next->count++] = *existing;
+  }
+  if(!inserted){
+    next->sources[next->count++] = source;
+  }
+  for (int i = 0; i < next->count; i++)
+  {
+    if(is_directory(next->sources[i].kind)){
+      next->roots[next->numRoots++] = next->sources[i].path;
+    }
+  }
+  return next;
+}
+
+bool wrt_loader_add(WrtModuleSourceKind kind, const char* path, int priority){
+  ModuleSource source = {0};
+  source.kind = kind;
+  source.priority = priority;
+  if(kind != WRT_SOURCE_MEMORY && path == NULL){
+    WRT_ERROR("A %s module source needs a path", kindNames[kind]);
+    return false;
+  }
+  if(kind == WRT_SOURCE_BUNDLE){
+    source.bundle = wrt_bundle_open(path);
+    if(source.bundle == NULL) return false;
+  } else if(is_directory(kind)){
+    source.path = malloc(strlen(path) + 1);
+    strcpy(source.path, path);
+  }
+
+  MUTEX_LOCK(&loaderMutex);
+  SourceChain* next = insert_source(chain, source);
+  ATOMIC_STORE_PTR(&chain, next);
+  MUTEX_UNLOCK(&loaderMutex);
+  WRT_DEBUG("Added %s module source %s with priority %i", kindNames[kind], path != NULL ? path : "", priority);
+  return true;
+}
+
+bool wrt_loader_find(const char* name, bool load, WrtFoundModule* module){
+  module->source = NULL;
+  module->cached = NULL;
+  module->path[0] = 0;
+  module->binaryPath[0] = 0;
+  module->packaged = false;
+  module->hasBinary = false;
+
+  const SourceChain* current = ATOMIC_LOAD_PTR(&chain);
+  if(current == NULL) return false;
+  for (int i = 0; i < current->count; i++)
+  {
+    const ModuleSource* source = &current->sources[i];
+    if(source->kind == WRT_SOURCE_MEMORY){
+      module->source = wrt_memory_module_find(name);
+      if(module->source == NULL) continue;
+      module->packaged = true;
+      return true;
+    }
+    if(source->kind == WRT_SOURCE_BUNDLE){
+      uint32_t flags;
+      module->source = wrt_bundle_find(source->bundle, name, &flags);
+      if(module->source == NULL) continue;
+      module->packaged = true;
+      module->hasBinary = (flags & WRT_BUNDLE_HAS_BINARY) != 0;
+      return true;
+    }
+    if(!wrt_resolve_cache_lookup(source->path, name, module->path, module->binaryPath)) continue;
+    module->hasBinary = module->binaryPath[0] != 0;
+    if(load){
+      module->cached = wrt_module_cache_acquire(module->path, source->kind == WRT_SOURCE_MAPPED_DIRECTORY);
+      // Removed since it was resolved, the next source may still have it
+      if(module->cached == NULL) continue;
+      module->source = module->cached->text;
+    }
+    return true;
+  }
+  return false;
+}
+
+void wrt_loader_release(WrtFoundModule* module){
+  if(module->cached != NULL){
+    wrt_module_cache_release(module->cached);
+    module->cached = NULL;
+  }
+}
+
+bool wrt_loader_find_binary(const char* name, char* binaryPath){
+  const char** roots;
+  int numRoots = wrt_loader_roots(&roots);
+  char path[PATH_MAX];
+  for (int i = 0; i < numRoots; i++)
+  {
+    size_t length = cwk_path_join(roots[i], name, path, sizeof(path));
+    if(length + sizeof(".wren") > sizeof(path)) continue;
+    strcpy(path + length, ".wren");
+    const char* candidate = wrt_resolve_binary_module(path);
+    bool found = wrt_file_exists(candidate);
+    if(found) strcpy(binaryPath, candidate);
+    free((void*)candidate);
+    if(found) return true;
+  }
+  return false;
+}
+
+int wrt_loader_roots(const char*** roots){
+  const SourceChain* current = ATOMIC_LOAD_PTR(&chain);
+  if(current == NULL){
+    *roots = NULL;
+    return 0;
+  }
+  *roots = current->roots;
+  return current->numRoots;
+}
@@ -0,0 +1,41 @@
+#ifndef WRT_LOADER_H
+#define WRT_LOADER_H
+
+#include <stdbool.h>
+#include <limits.h>
+
+#include <wren_runtime.h>
+
+#include "module_cache.h"
+
+// The chain of sources installed modules are looked up in, highest priority
+// first. Every source has its own lookup: memory modules a hash map, bundles
+// their index and directories the resolution cache keyed by their root.
+typedef struct {
+  // Set when the module was loaded, valid until wrt_loader_release
+  const char* source;
+  WrtCachedSource* cached;
+  // The file the module was read from, empty for memory and bundle modules
+  char path[PATH_MAX];
+  // Binary part installed next to a module in a directory, empty if none
+  char binaryPath[PATH_MAX];
+  bool packaged;
+  // The module has a binary part, for packaged modules it is only located
+  // by wrt_loader_find_binary
+  bool hasBinary;
+} WrtFoundModule;
+
+void wrt_loader_init(void);
+void wrt_loader_before_fork(void);
+void wrt_loader_after_fork(void);
+bool wrt_loader_add(WrtModuleSourceKind kind, const char* path, int priority);
+// Finds an installed module. With load set its source is acquired as well
+// and has to be given back with wrt_loader_release.
+bool wrt_loader_find(const char* name, bool load, WrtFoundModule* module);
+void wrt_loader_release(WrtFoundModule* module);
+// Searches the directory sources for the binary part of a packaged module
+bool wrt_loader_find_binary(const char* name, char* binaryPath);
+// Directory roots in priority order, valid for the rest of the process
+int wrt_loader_roots(const char*** roots);
+
+#endif
@@ -0,0 +1,181 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#if defined(_WIN32)
+  #include <io.h>
+#else
+  #include <unistd.h>
+#endif
+
+#include "log.h"
+#include "atomic.h"
+#include "thread.h"
+#include "os_call.h"
+
+#define RING_SIZE 1024
+#define RING_MASK (RING_SIZE - 1)
+#define MESSAGE_SIZE 256
+#define LINE_SIZE (MESSAGE_SIZE + 16)
+#define BATCH_SIZE (64 * LINE_SIZE)
+#define FLUSH_TIMEOUT_US 1000000
+
+typedef struct {
+  uint32_t sequence;
+  WrtLogLevel level;
+  char text[MESSAGE_SIZE];
+} LogSlot;
+
+int wrtLogLevel = WRT_LOG_LEVEL;
+
+// Bounded queue after Dmitry Vyukov: the sequence of a slot tells producers
+// and the writer whose turn it is, nobody takes a lock
+static LogSlot ring[RING_SIZE];
+static uint32_t head;
+static uint32_t tail;
+// Position up to which messages reached stderr
+static uint32_t written;
+static uint32_t dropped;
+static int running;
+static bool exitHandlerSet;
+static SEMAPHORE pending;
+static THREAD writer;
+
+static const char* levelNames[] = { "TRACE", "DEBUG", "INFO", "WARN", "ERROR", "OFF" };
+
+static void write_all(const char* text, size_t length){
+  while(length > 0){
+#if defined(_WIN32)
+    int count = _write(2, text, (unsigned int)length);
+#else
+    ssize_t count = write(2, text, length);
+#endif
+    if(count <= 0) return;
+    text += count;
+    length -= count;
+  }
+}
+
+static size_t format_line(char* line, size_t size, WrtLogLevel level, const char* text){
+  int length = snprintf(line, size, "[wrt %s] %s\n", levelNames[level], text);
+  if(length < 0) return 0;
+  return (size_t)length < size ? (size_t)length : size - 1;
+}
+
+static LogSlot* claim_slot(uint32_t* position){
+  uint32_t pos = ATOMIC_LOAD_INT(&head);
+  while(true){
+    LogSlot* slot = &ring[pos & RING_MASK];
+    int32_t diff = (int32_t)(ATOMIC_LOAD_INT(&slot->sequence) - pos);
+    if(diff == 0){
+      if(ATOMIC_CAS_INT(&head, pos, pos + 1)){
+        *position = pos;
+        return slot;
+      }
+    } else if(diff < 0){
+      // The writer has not caught up with a full ring
+      return NULL;
+    }
+    pos = ATOMIC_LOAD_INT(&head);
+  }
+}
+
+// Only ever runs on the writer thread
+static void drain(){
+  static char batch[BATCH_SIZE];
+  size_t used = 0;
+  while(true){
+    LogSlot* slot = &ring[tail & RING_MASK];
+    if((int32_t)(ATOMIC_LOAD_INT(&slot->sequence) - (tail + 1)) < 0) break;
+    if(used + LINE_SIZE > BATCH_SIZE){
+      write_all(batch, used);
+      used = 0;
+    }
+    used += format_line(batch + used, BATCH_SIZE - used, slot->level, slot->text);
+    ATOMIC_STORE_INT(&slot->sequence, tail + RING_SIZE);
+    tail++;
+  }
+  uint32_t lost = ATOMIC_LOAD_INT(&dropped);
+  if(lost > 0){
+    ATOMIC_FETCH_ADD_INT(&dropped, (uint32_t)0 - lost);
+    if(used + LINE_SIZE > BATCH_SIZE){
+      write_all(batch, used);
+      used = 0;
+    }
+    used += snprintf(batch + used, BATCH_SIZE - used, "[wrt WARN] %u log messages dropped\n", lost);
+  }
+  if(used > 0){
+    write_all(batch, used);
+  }
+  ATOMIC_STORE_INT(&written, tail);
+}
+
+static void writer_main(void* arg){
+  while(true){
+    SEMAPHORE_WAIT(&pending);
+    drain();
+  }
+}
+
+void wrt_log_write(WrtLogLevel level, const char* format, ...){
+  va_list args;
+  va_start(args, format);
+  uint32_t pos;
+  LogSlot* slot = ATOMIC_LOAD_INT(&running) ? claim_slot(&pos) : NULL;
+  if(slot != NULL){
+    slot->level = level;
+    vsnprintf(slot->text, MESSAGE_SIZE, format, args);
+    ATOMIC_STORE_INT(&slot->sequence, pos + 1);
+    SEMAPHORE_POST(&pending);
+  } else if(ATOMIC_LOAD_INT(&running)){
+    ATOMIC_FETCH_ADD_INT(&dropped, 1);
+  } else {
+    // No writer thread yet, write synchronously
+    char text[MESSAGE_SIZE];
+    char line[LINE_SIZE];
+    vsnprintf(text, MESSAGE_SIZE, format, args);
+    write_all(line, format_line(line, LINE_SIZE, level, text));
+  }
+  va_end(args);
+}
+
+void wrt_flush_log(){
+  if(!ATOMIC_LOAD_INT(&running)) return;
+  uint32_t target = ATOMIC_LOAD_INT(&head);
+  SEMAPHORE_POST(&pending);
+  uint64_t deadline = wrt_clock_us() + FLUSH_TIMEOUT_US;
+  while((int32_t)(ATOMIC_LOAD_INT(&written) - target) < 0 && wrt_clock_us() < deadline){
+    wrt_sleep_us(100);
+  }
+}
+
+void wrt_set_log_level(WrtLogLevel level){
+  ATOMIC_STORE_INT(&wrtLogLevel, level);
+}
+
+static void flush_at_exit(){
+  wrt_flush_log();
+}
+
+void wrt_log_start(){
+  if(ATOMIC_LOAD_INT(&running)) return;
+  for (uint32_t i = 0; i < RING_SIZE; i++)
+  {
+    ring[i].sequence = i;
+  }
+  head = 0;
+  tail = 0;
+  written = 0;
+  dropped = 0;
+  if(SEMAPHORE_INIT(&pending) != 0) return;
+  if(THREAD_START(&writer, writer_main, NULL) != 0) return;
+  ATOMIC_STORE_INT(&running, 1);
+  if(!exitHandlerSet){
+    exitHandlerSet = true;
+    atexit(flush_at_exit);
+  }
+}
+
+void wrt_log_after_fork(){
+  running = 0;
+}
@@ -0,0 +1,52 @@
+#ifndef WRT_LOG_H
+#define WRT_LOG_H
+
+#include <wren_runtime.h>
+
+// Messages below this level are not compiled in at all:
+// 0 trace, 1 debug, 2 info, 3 warn, 4 error, 5 off
+#ifndef WRT_LOG_LEVEL
+  #define WRT_LOG_LEVEL 2
+#endif
+
+// Runtime floor on top of the compile-time one, see wrt_set_log_level
+extern int wrtLogLevel;
+
+// Formats into a lock-free ring buffer that a background thread writes to
+// stderr. Messages are dropped, and counted, when the ring is full.
+void wrt_log_write(WrtLogLevel level, const char* format, ...);
+void wrt_log_start(void);
+// In a forked child: drops the parent's pending messages and writes
+// synchronously, the writer thread did not come along. wrt_log_start
+// starts a new one.
+void wrt_log_after_fork(void);
+
+#define WRT_LOG_AT(level, ...) do { if((level) >= wrtLogLevel) wrt_log_write((level), __VA_ARGS__); } while(0)
+
+#if WRT_LOG_LEVEL <= 0
+  #define WRT_TRACE(...) WRT_LOG_AT(WRT_LOG_TRACE, __VA_ARGS__)
+#else
+  #define WRT_TRACE(...) ((void)0)
+#endif
+#if WRT_LOG_LEVEL <= 1
+  #define WRT_DEBUG(...) WRT_LOG_AT(WRT_LOG_DEBUG, __VA_ARGS__)
+#else
+  #define WRT_DEBUG(...) ((void)0)
+#endif
+#if WRT_LOG_LEVEL <= 2
+  #define WRT_INFO(...) WRT_LOG_AT(WRT_LOG_INFO, __VA_ARGS__)
+#else
+  #define WRT_INFO(...) ((void)0)
+#endif
+#if WRT_LOG_LEVEL <= 3
+  #define WRT_WARN(...) WRT_LOG_AT(WRT_LOG_WARN, __VA_ARGS__)
+#else
+  #define WRT_WARN(...) ((void)0)
+#endif
+#if WRT_LOG_LEVEL <= 4
+  #define WRT_ERROR(...) WRT_LOG_AT(WRT_LOG_ERROR, __VA_ARGS__)
+#else
+  #define WRT_ERROR(...) ((void)0)
+#endif
+
+#endif
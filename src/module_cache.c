@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <stb_ds.h>
+
+#include "module_cache.h"
+#include "modules.h"
+#include "mutex.h"
+#include "os_call.h"
+
+// Entries are only re-checked against the filesystem after this interval,
+// so repeated imports of a cached module do not touch the disk at all.
+#define DEFAULT_REVALIDATE_US 1000000
+// Smaller files are cheaper to copy than to map
+#define MMAP_THRESHOLD (64 * 1024)
+
+typedef struct {
+  char* key;
+  WrtCachedSource* value;
+} CacheEntry;
+
+static MUTEX cacheMutex;
+static CacheEntry* cache = NULL;
+static uint64_t revalidateInterval = DEFAULT_REVALIDATE_US;
+
+typedef struct {
+  int64_t mtime;
+  uint64_t inode;
+  int64_t size;
+} FileStamp;
+
+static bool stamp_file(const char* path, FileStamp* stamp){
+  struct stat st;
+  if(stat(path, &st) != 0 || (st.st_mode & S_IFMT) != S_IFREG){
+    return false;
+  }
+#if defined(__linux__)
+  stamp->mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#else
+  stamp->mtime = (int64_t)st.st_mtime;
+#endif
+  stamp->inode = (uint64_t)st.st_ino;
+  stamp->size = (int64_t)st.st_size;
+  return true;
+}
+
+static bool stamp_matches(const FileStamp* cached, const FileStamp* stamp){
+  return cached->mtime == stamp->mtime && cached->inode == stamp->inode && cached->size == stamp->size;
+}
+
+static FileStamp stamp_of(const WrtCachedSource* source){
+  FileStamp stamp = { source->mtime, source->inode, source->size };
+  return stamp;
+}
+
+static WrtCachedSource* load_source(const char* path, FileStamp* stamp, bool map){
+  bool mapped = map || stamp->size >= MMAP_THRESHOLD;
+  size_t length = 0;
+  const char* text = mapped ? wrt_map_file(path, &length) : wrt_read_file(path);
+  if(text == NULL) return NULL;
+  WrtCachedSource* source = calloc(1, sizeof(WrtCachedSource));
+  source->text = text;
+  source->length = mapped ? length : strlen(text);
+  source->mapped = mapped;
+  source->refs = 1;
+  source->mtime = stamp->mtime;
+  source->inode = stamp->inode;
+  source->size = stamp->size;
+  return source;
+}
+
+// Must be called with cacheMutex held
+static void unref_source(WrtCachedSource* source){
+  if(--source->refs == 0){
+    if(source->mapped){
+      wrt_unmap_file(source->text, source->length);
+    } else {
+      free((void*)source->text);
+    }
+    free(source);
+  }
+}
+
+void wrt_module_cache_init(void){
+  MUTEX_INIT(&cacheMutex);
+  sh_new_strdup(cache);
+}
+
+void wrt_module_cache_before_fork(void){
+  MUTEX_LOCK(&cacheMutex);
+}
+
+void wrt_module_cache_after_fork(void){
+  MUTEX_UNLOCK(&cacheMutex);
+}
+
+WrtCachedSource* wrt_module_cache_acquire(const char* path, bool map){
+  MUTEX_LOCK(&cacheMutex);
+  uint64_t now = wrt_clock_us();
+  WrtCachedSource* source = shget(cache, path);
+  if(source != NULL && now - source->checkedAt < revalidateInterval){
+    source->refs++;
+    MUTEX_UNLOCK(&cacheMutex);
+    return source;
+  }
+  // The entry may be replaced and freed once the lock is dropped, only its
+  // stamp is used from here on
+  bool cached = source != NULL;
+  FileStamp cachedStamp = cached ? stamp_of(source) : (FileStamp){0};
+  MUTEX_UNLOCK(&cacheMutex);
+
+  // Stat and read outside the lock, other VMs keep hitting the cache meanwhile
+  FileStamp stamp;
+  bool exists = stamp_file(path, &stamp);
+  WrtCachedSource* loaded = NULL;
+  if(exists && (!cached || !stamp_matches(&cachedStamp, &stamp))){
+    loaded = load_source(path, &stamp, map);
+  }
+
+  while(true){
+    MUTEX_LOCK(&cacheMutex);
+    WrtCachedSource* current = shget(cache, path);
+    if(!exists){
+      if(current != NULL){
+        shdel(cache, path);
+        unref_source(current);
+      }
+      current = NULL;
+    } else if(loaded != NULL){
+      if(current != NULL){
+        unref_source(current);
+      }
+      loaded->checkedAt = now;
+      shput(cache, path, loaded);
+      current = loaded;
+    } else if(current != NULL){
+      FileStamp currentStamp = stamp_of(current);
+      if(stamp_matches(&currentStamp, &stamp)){
+        current->checkedAt = now;
+      }
+    } else {
+      // The entry that matched was dropped meanwhile, load it after all
+      MUTEX_UNLOCK(&cacheMutex);
+      loaded = load_source(path, &stamp, map);
+      if(loaded == NULL) return NULL;
+      continue;
+    }
+    if(current != NULL){
+      current->refs++;
+    }
+    MUTEX_UNLOCK(&cacheMutex);
+    return current;
+  }
+}
+
+void wrt_module_cache_release(WrtCachedSource* source){
+  MUTEX_LOCK(&cacheMutex);
+  unref_source(source);
+  MUTEX_UNLOCK(&cacheMutex);
+}
+
+void wrt_module_cache_set_interval(uint64_t intervalUs){
+  MUTEX_LOCK(&cacheMutex);
+  revalidateInterval = intervalUs;
+  MUTEX_UNLOCK(&cacheMutex);
+}
+
+void wrt_module_cache_clear(void){
+  MUTEX_LOCK(&cacheMutex);
+  for (int i = 0; i < shlen(cache); i++)
+  {
+    unref_source(cache[i].value);
+  }
+  shfree(cache);
+  sh_new_strdup(cache);
+  MUTEX_UNLOCK(&cacheMutex);
+}
@@ -0,0 +1,31 @@
+#ifndef WRT_MODULE_CACHE_H
+#define WRT_MODULE_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct WrtCachedSource {
+  const char* text;
+  size_t length;
+  bool mapped;
+  int refs;
+  int64_t mtime;
+  uint64_t inode;
+  int64_t size;
+  uint64_t checkedAt;
+} WrtCachedSource;
+
+void wrt_module_cache_init(void);
+void wrt_module_cache_before_fork(void);
+void wrt_module_cache_after_fork(void);
+// Returns a shared, immutable source for path or NULL if it can not be read.
+// Every acquired source must be given back with wrt_module_cache_release.
+// Small files are copied unless map is set, a cached source keeps the way it
+// was loaded until the file changes.
+WrtCachedSource* wrt_module_cache_acquire(const char* path, bool map);
+void wrt_module_cache_release(WrtCachedSource* source);
+void wrt_module_cache_set_interval(uint64_t intervalUs);
+void wrt_module_cache_clear(void);
+
+#endif
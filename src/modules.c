@@ -4,13 +4,20 @@
 #include <limits.h>
 #include <cwalk.h>
 #include <stdlib.h>
+#if defined(__unix__)
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+#endif
 #include "modules.h"
+#include "log.h"
 
 const char* wrt_read_file(const char *filename)
 {
   FILE* file = fopen(filename, "rb");
   if(file == NULL){
-    printf("File not found %s\n", filename);
+    WRT_ERROR("File not found %s", filename);
     return NULL;
   }
   long old = ftell(file);
@@ -25,6 +32,60 @@ const char* wrt_read_file(const char *filename)
   return (const char*)buffer;
 }
 
+#if defined(__unix__)
+static size_t mapping_size(size_t size){
+  // One byte more than the file, so a file ending on a page boundary still gets its NUL
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  return (size + 1 + page - 1) & ~(page - 1);
+}
+#endif
+
+const char* wrt_map_file(const char* filename, size_t* size)
+{
+#if defined(__unix__)
+  int fd = open(filename, O_RDONLY | O_CLOEXEC);
+  if(fd < 0){
+    WRT_ERROR("File not found %s", filename);
+    return NULL;
+  }
+  struct stat st;
+  if(fstat(fd, &st) != 0){
+    close(fd);
+    return NULL;
+  }
+  size_t length = mapping_size((size_t)st.st_size);
+  // Reserve zeroed pages first and map the file over their start. The kernel
+  // zero-fills the rest of the last file page, the reservation covers the
+  // case where the file size is a multiple of the page size.
+  char* base = mmap(NULL, length, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(base == MAP_FAILED){
+    close(fd);
+    return NULL;
+  }
+  if(st.st_size > 0 && mmap(base, (size_t)st.st_size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED){
+    munmap(base, length);
+    close(fd);
+    return NULL;
+  }
+  close(fd);
+  *size = (size_t)st.st_size;
+  return (const char*)base;
+#else
+  const char* text = wrt_read_file(filename);
+  if(text != NULL) *size = strlen(text);
+  return text;
+#endif
+}
+
+void wrt_unmap_file(const char* text, size_t size)
+{
+#if defined(__unix__)
+  munmap((void*)text, mapping_size(size));
+#else
+  free((void*)text);
+#endif
+}
+
 bool wrt_file_exists(const char* filename){
   FILE* file = fopen(filename, "rb");
   if(file == NULL){
@@ -47,12 +108,18 @@ static inline const char* create_string(int size){
 }
 
 bool wrt_is_file_module(const char* path){
-  return path[0] == '.';
+  return path[0] == '.' || cwk_path_is_absolute(path);
 }
 
 const char* wrt_resolve_file_module(const char* importer, const char* name){
+  if(cwk_path_is_absolute(name)){
+    char* result = (char*)create_string(strlen(name) + 5);
+    strcpy(result, name);
+    strcat(result, ".wren");
+    return result;
+  }
   char* base = (char*)copy_string(importer);
-  int length;
+  size_t length;
   cwk_path_get_dirname((const char*)base, &length);
   base[length] = 0;
   size_t result_size = length + strlen(name) + 5; // 5 for ".wren"
@@ -63,26 +130,12 @@ const char* wrt_resolve_file_module(const char* importer, const char* name){
   return result;
 }
 
-const char* wrt_resolve_installed_module(const char** locations, int num_locations, const char* name){
-  char buffer[PATH_MAX];
-  for (size_t i = 0; i < num_locations; i++)
-  {
-    int size = cwk_path_join(locations[i], name, buffer, sizeof(buffer));
-    strcat(buffer, ".wren");
-    if(wrt_file_exists((const char*)buffer)){
-      const char* result = copy_string((const char*)buffer);
-      return result;
-    }
-  }
-  return NULL;
-}
-
 const char* wrt_resolve_binary_module(const char* path){
   const char* dll_path = copy_string(path);
   #if defined(_WIN32)
-  cwk_path_change_extension(path, ".dll", (char*)dll_path, strlen(dll_path));
+  cwk_path_change_extension(path, ".dll", (char*)dll_path, strlen(dll_path) + 1);
   #elif defined(__unix__)
-  cwk_path_change_extension(path, ".so", dll_path, str_len(dll_path));
+  cwk_path_change_extension(path, ".so", (char*)dll_path, strlen(dll_path) + 1);
   #endif
   return dll_path;
 }
\ No newline at end of file
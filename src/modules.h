@@ -3,10 +3,12 @@
 
 bool wrt_file_exists(const char* filename);
 const char* wrt_read_file(const char *filename);
+// Maps a file read-only with a guaranteed trailing NUL, release with wrt_unmap_file
+const char* wrt_map_file(const char* filename, size_t* size);
+void wrt_unmap_file(const char* text, size_t size);
 bool wrt_is_file_module(const char* path);
 const char* wrt_resolve_file_module(const char* importer, const char* name);
 const char* wrt_resolve_binary_module(const char* path);
-const char* wrt_resolve_installed_module(const char** locations, int num_locations, const char* name);
 
 
 #endif
\ No newline at end of file
@@ -5,11 +5,13 @@
   #include <windows.h>
 #elif defined(__unix__)
   #include <dlfcn.h>
+  #include <time.h>
 #else
   #error unsupported platform
 #endif
 
 #include "os_call.h"
+#include "log.h"
 
 #define RTLD_DEFAULT 0
 #define RTLD_LAZY   1
@@ -29,7 +31,7 @@ static BOOL PrintErrorMessage(DWORD dwErrorCode)
                                  1024,
                                  NULL);
     if(cchMsg > 0){
-      printf("WINDOWS ERROR: %s\n", pBuffer);
+      WRT_ERROR("Windows error: %s", pBuffer);
     }
 
     free(pBuffer);
@@ -41,17 +43,17 @@ void* wrt_dlopen(const char *pcDllname)
   #if defined(_WIN32)
     void* handle = (void*)LoadLibrary(pcDllname);
     if(handle == NULL) {
-      printf("Error loading %s\n", pcDllname);
+      WRT_ERROR("Error loading %s", pcDllname);
       PrintErrorMessage(GetLastError());
     }
     return handle;
   #elif defined(__GNUC__)
     void* handle = dlopen(pcDllname, RTLD_DEFAULT);
-    if(handle == NULL) printf("Error loading %s. Reason %s\n", pcDllname, dlerror());
-    printf("Loaded posix plugin %s\n", pcDllname);
+    if(handle == NULL) WRT_ERROR("Error loading %s. Reason %s", pcDllname, dlerror());
+    else WRT_DEBUG("Loaded posix plugin %s", pcDllname);
     return handle;
   #else
-    printf("Error: Native Plugin loading is not supported by platform\n");
+    WRT_ERROR("Native Plugin loading is not supported by platform");
   #endif
 }
 
@@ -72,3 +74,27 @@ int wrt_dlclose(void *hDLL)
     return dlclose(hDLL);
 #endif
 }
+
+uint64_t wrt_clock_us(void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER freq, now;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (uint64_t)(now.QuadPart / freq.QuadPart) * 1000000 + (uint64_t)(now.QuadPart % freq.QuadPart) * 1000000 / freq.QuadPart;
+#elif defined(__unix__)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+void wrt_sleep_us(uint64_t us)
+{
+#if defined(_WIN32)
+    Sleep((DWORD)((us + 999) / 1000));
+#elif defined(__unix__)
+    struct timespec ts = { (time_t)(us / 1000000), (long)(us % 1000000) * 1000 };
+    nanosleep(&ts, NULL);
+#endif
+}
@@ -2,8 +2,12 @@
 #ifndef os_call_h
 #define os_call_h
 
+#include <stdint.h>
+
 void* wrt_dlopen(const char *pcDllname);
 void *wrt_dlsym(void *Lib, char *Fnname);
 int wrt_dlclose(void *hDLL);
+uint64_t wrt_clock_us(void);
+void wrt_sleep_us(uint64_t us);
 
 #endif //os_call_h
\ No newline at end of file
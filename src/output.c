@@ -0,0 +1,104 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(_WIN32)
+  #include <io.h>
+#elif defined(__unix__)
+  #include <unistd.h>
+  #include <sys/uio.h>
+#endif
+
+#include "output.h"
+
+void wrt_output_init(WrtOutput* output, size_t size){
+  output->buffer = size > 0 ? malloc(size) : NULL;
+  output->size = output->buffer != NULL ? size : 0;
+  output->used = 0;
+  output->fd = 1;
+  output->fn = NULL;
+  output->data = NULL;
+}
+
+#if defined(_WIN32)
+static void write_all(int fd, const char* text, size_t length){
+  while(length > 0){
+    int written = _write(fd, text, (unsigned int)length);
+    if(written <= 0) return;
+    text += written;
+    length -= written;
+  }
+}
+
+static void emit(WrtOutput* output, const char* first, size_t firstLength, const char* second, size_t secondLength){
+  write_all(output->fd, first, firstLength);
+  write_all(output->fd, second, secondLength);
+}
+#else
+// Both parts go out in a single writev, only a short write needs another one
+static void emit(WrtOutput* output, const char* first, size_t firstLength, const char* second, size_t secondLength){
+  struct iovec parts[2] = {
+    { (void*)first, firstLength },
+    { (void*)second, secondLength }
+  };
+  struct iovec* part = parts;
+  int numParts = 2;
+  while(numParts > 0){
+    if(part->iov_len == 0){
+      part++;
+      numParts--;
+      continue;
+    }
+    ssize_t written = writev(output->fd, part, numParts);
+    if(written < 0){
+      if(errno == EINTR) continue;
+      return;
+    }
+    while(numParts > 0 && (size_t)written >= part->iov_len){
+      written -= part->iov_len;
+      part++;
+      numParts--;
+    }
+    if(numParts > 0){
+      part->iov_base = (char*)part->iov_base + written;
+      part->iov_len -= written;
+    }
+  }
+}
+#endif
+
+static void deliver(WrtOutput* output, WrenVM* vm, const char* text, size_t length){
+  if(output->fn != NULL){
+    if(output->used > 0) output->fn(vm, output->buffer, output->used, output->data);
+    if(length > 0) output->fn(vm, text, length, output->data);
+  } else {
+    emit(output, output->buffer, output->used, text, length);
+  }
+  output->used = 0;
+}
+
+void wrt_output_write(WrtOutput* output, WrenVM* vm, const char* text){
+  size_t length = strlen(text);
+  if(output->used + length > output->size){
+    // Does not fit, the buffered text and the new text go out together
+    deliver(output, vm, text, length);
+    return;
+  }
+  memcpy(output->buffer + output->used, text, length);
+  output->used += length;
+  if(output->used == output->size || memchr(text, '\n', length) != NULL){
+    deliver(output, vm, NULL, 0);
+  }
+}
+
+void wrt_output_flush(WrtOutput* output, WrenVM* vm){
+  if(output->used > 0){
+    deliver(output, vm, NULL, 0);
+  }
+}
+
+void wrt_output_free(WrtOutput* output){
+  free(output->buffer);
+  output->buffer = NULL;
+  output->size = 0;
+  output->used = 0;
+}
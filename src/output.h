@@ -0,0 +1,24 @@
+#ifndef WRT_OUTPUT_H
+#define WRT_OUTPUT_H
+
+#include <stddef.h>
+#include <wren_runtime.h>
+
+// Buffered System.print/System.write output of a single VM. Text is flushed
+// on a newline or once the buffer is full, with one write per flush, so the
+// lines of different VMs do not interleave.
+typedef struct {
+  char* buffer;
+  size_t size;
+  size_t used;
+  int fd;
+  WrtOutputFn fn;
+  void* data;
+} WrtOutput;
+
+void wrt_output_init(WrtOutput* output, size_t size);
+void wrt_output_write(WrtOutput* output, WrenVM* vm, const char* text);
+void wrt_output_flush(WrtOutput* output, WrenVM* vm);
+void wrt_output_free(WrtOutput* output);
+
+#endif
@@ -0,0 +1,117 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <stb_ds.h>
+
+#include "prefetch.h"
+#include "mutex.h"
+#include "thread.h"
+#include "atomic.h"
+#include "log.h"
+
+typedef struct {
+  char* key;
+  int value;
+} SeenName;
+
+static MUTEX prefetchMutex;
+static SEMAPHORE pending;
+static WrtPrefetchFn prefetchFn;
+static int maxThreads = 0;
+static int numThreads = 0;
+// FIFO of owned names, queueHead is the next one to take
+static char** queue = NULL;
+static int queueHead = 0;
+static SeenName* seen = NULL;
+
+static void worker_main(void* arg){
+  (void)arg;
+  while(SEMAPHORE_WAIT(&pending) == 0){
+    MUTEX_LOCK(&prefetchMutex);
+    char* name = NULL;
+    if(queueHead < arrlen(queue)){
+      name = queue[queueHead++];
+      if(queueHead == arrlen(queue)){
+        arrsetlen(queue, 0);
+        queueHead = 0;
+      }
+    }
+    MUTEX_UNLOCK(&prefetchMutex);
+    if(name == NULL) continue;
+    WRT_TRACE("Prefetch %s", name);
+    prefetchFn(name);
+    free(name);
+  }
+}
+
+// Must be called with prefetchMutex held
+static void start_worker(void){
+  THREAD thread;
+  if(THREAD_START(&thread, worker_main, NULL) == 0){
+    numThreads++;
+  } else {
+    WRT_WARN("Could not start import prefetch thread");
+    // Do not retry on every import
+    maxThreads = numThreads;
+  }
+}
+
+void wrt_prefetch_init(WrtPrefetchFn fn){
+  prefetchFn = fn;
+  MUTEX_INIT(&prefetchMutex);
+  SEMAPHORE_INIT(&pending);
+  sh_new_strdup(seen);
+}
+
+void wrt_prefetch_before_fork(void){
+  MUTEX_LOCK(&prefetchMutex);
+}
+
+void wrt_prefetch_after_fork(void){
+  MUTEX_UNLOCK(&prefetchMutex);
+}
+
+void wrt_prefetch_reset_in_child(void){
+  SEMAPHORE_INIT(&pending);
+  for (int i = queueHead; i < arrlen(queue); i++)
+  {
+    free(queue[i]);
+  }
+  arrsetlen(queue, 0);
+  queueHead = 0;
+  numThreads = 0;
+}
+
+void wrt_prefetch_set_threads(int threads){
+  ATOMIC_STORE_INT(&maxThreads, threads > 0 ? threads : 0);
+}
+
+bool wrt_prefetch_enabled(void){
+  return ATOMIC_LOAD_INT(&maxThreads) > 0;
+}
+
+void wrt_prefetch_submit(const char* name){
+  if(!wrt_prefetch_enabled()) return;
+  MUTEX_LOCK(&prefetchMutex);
+  if(shgeti(seen, name) >= 0){
+    MUTEX_UNLOCK(&prefetchMutex);
+    return;
+  }
+  shput(seen, name, 1);
+  char* copy = malloc(strlen(name) + 1);
+  strcpy(copy, name);
+  arrput(queue, copy);
+  // One more worker while the backlog is larger than the pool
+  if(numThreads < maxThreads && arrlen(queue) - queueHead > numThreads){
+    start_worker();
+  }
+  MUTEX_UNLOCK(&prefetchMutex);
+  SEMAPHORE_POST(&pending);
+}
+
+void wrt_prefetch_clear(void){
+  MUTEX_LOCK(&prefetchMutex);
+  shfree(seen);
+  sh_new_strdup(seen);
+  MUTEX_UNLOCK(&prefetchMutex);
+}
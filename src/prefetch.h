@@ -0,0 +1,25 @@
+#ifndef WRT_PREFETCH_H
+#define WRT_PREFETCH_H
+
+#include <stdbool.h>
+
+// Resolved module names are handed to a small pool of threads that warm
+// whatever loading them needs before a VM imports them. Each name is
+// queued once until cleared.
+typedef void (*WrtPrefetchFn)(const char* name);
+
+void wrt_prefetch_init(WrtPrefetchFn fn);
+// Hold the lock across fork()
+void wrt_prefetch_before_fork(void);
+void wrt_prefetch_after_fork(void);
+// In the child, after wrt_prefetch_after_fork: the workers did not come
+// along, queued names are dropped and workers are started again on demand
+void wrt_prefetch_reset_in_child(void);
+// Threads are started on demand up to this count, 0 turns prefetching off.
+// Lowering it does not stop threads that already run.
+void wrt_prefetch_set_threads(int threads);
+bool wrt_prefetch_enabled(void);
+void wrt_prefetch_submit(const char* name);
+void wrt_prefetch_clear(void);
+
+#endif
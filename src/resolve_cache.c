@@ -0,0 +1,175 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <cwalk.h>
+
+#include <stb_ds.h>
+#include <wrt_hash.h>
+
+#include "resolve_cache.h"
+#include "modules.h"
+#include "mutex.h"
+#include "os_call.h"
+
+#define DEFAULT_REVALIDATE_US 1000000
+#define WREN_EXTENSION ".wren"
+
+typedef struct {
+  // NULL when the module is not installed
+  char* wrenPath;
+  char* binaryPath;
+  // Combined mtime and inode of the directory the module was searched in
+  uint64_t dirStamp;
+  uint64_t checkedAt;
+} Resolution;
+
+typedef struct {
+  char* key;
+  Resolution value;
+} ResolveEntry;
+
+static MUTEX resolveMutex;
+static ResolveEntry* resolved = NULL;
+static uint64_t revalidateInterval = DEFAULT_REVALIDATE_US;
+
+// Joins root and name and appends the extension, false if it does not fit
+static bool candidate_path(const char* root, const char* name, char* buffer){
+  size_t length = cwk_path_join(root, name, buffer, PATH_MAX);
+  if(length + sizeof(WREN_EXTENSION) > PATH_MAX) return false;
+  strcpy(buffer + length, WREN_EXTENSION);
+  return true;
+}
+
+// Stamps the directory the module would be in
+static uint64_t stamp_dir(const char* candidate){
+  char buffer[PATH_MAX];
+  size_t length;
+  cwk_path_get_dirname(candidate, &length);
+  if(length == 0){
+    strcpy(buffer, ".");
+  } else {
+    memcpy(buffer, candidate, length);
+    buffer[length] = 0;
+  }
+  uint64_t stamp = WRT_FNV_OFFSET;
+  struct stat st;
+  if(stat(buffer, &st) != 0){
+    return wrt_hash_u64(stamp, 0);
+  }
+#if defined(__linux__)
+  stamp = wrt_hash_u64(stamp, (uint64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec);
+#else
+  stamp = wrt_hash_u64(stamp, (uint64_t)st.st_mtime);
+#endif
+  return wrt_hash_u64(stamp, (uint64_t)st.st_ino);
+}
+
+static Resolution probe(const char* candidate){
+  Resolution resolution = {0};
+  resolution.dirStamp = stamp_dir(candidate);
+  if(!wrt_file_exists(candidate)) return resolution;
+  resolution.wrenPath = strdup(candidate);
+  const char* binaryPath = wrt_resolve_binary_module(candidate);
+  if(wrt_file_exists(binaryPath)){
+    resolution.binaryPath = (char*)binaryPath;
+  } else {
+    free((void*)binaryPath);
+  }
+  return resolution;
+}
+
+static void free_resolution(Resolution* resolution){
+  free(resolution->wrenPath);
+  free(resolution->binaryPath);
+}
+
+static bool copy_out(const Resolution* resolution, char* wrenPath, char* binaryPath){
+  if(resolution->wrenPath == NULL) return false;
+  strcpy(wrenPath, resolution->wrenPath);
+  strcpy(binaryPath, resolution->binaryPath != NULL ? resolution->binaryPath : "");
+  return true;
+}
+
+// Must be called with resolveMutex held. The bundled stb_ds computes the
+// wrong entry in shgetp_null, so this goes through the index.
+static ResolveEntry* find_entry(const char* name){
+  ptrdiff_t index = shgeti(resolved, name);
+  return index >= 0 ? &resolved[index] : NULL;
+}
+
+void wrt_resolve_cache_init(void){
+  MUTEX_INIT(&resolveMutex);
+  sh_new_strdup(resolved);
+}
+
+void wrt_resolve_cache_before_fork(void){
+  MUTEX_LOCK(&resolveMutex);
+}
+
+void wrt_resolve_cache_after_fork(void){
+  MUTEX_UNLOCK(&resolveMutex);
+}
+
+bool wrt_resolve_cache_lookup(const char* root, const char* name, char* wrenPath, char* binaryPath){
+  // Entries are keyed by the candidate path, so every root has its own
+  char candidate[PATH_MAX];
+  if(!candidate_path(root, name, candidate)) return false;
+
+  uint64_t now = wrt_clock_us();
+  MUTEX_LOCK(&resolveMutex);
+  ResolveEntry* entry = find_entry(candidate);
+  if(entry != NULL && now - entry->value.checkedAt < revalidateInterval){
+    bool found = copy_out(&entry->value, wrenPath, binaryPath);
+    MUTEX_UNLOCK(&resolveMutex);
+    return found;
+  }
+  bool cached = entry != NULL;
+  uint64_t cachedStamp = cached ? entry->value.dirStamp : 0;
+  MUTEX_UNLOCK(&resolveMutex);
+
+  // Probe outside the lock, other VMs keep hitting the cache meanwhile
+  if(cached && stamp_dir(candidate) == cachedStamp){
+    MUTEX_LOCK(&resolveMutex);
+    entry = find_entry(candidate);
+    if(entry != NULL && entry->value.dirStamp == cachedStamp){
+      entry->value.checkedAt = now;
+      bool found = copy_out(&entry->value, wrenPath, binaryPath);
+      MUTEX_UNLOCK(&resolveMutex);
+      return found;
+    }
+    MUTEX_UNLOCK(&resolveMutex);
+  }
+
+  Resolution resolution = probe(candidate);
+  resolution.checkedAt = now;
+  bool found = copy_out(&resolution, wrenPath, binaryPath);
+  MUTEX_LOCK(&resolveMutex);
+  entry = find_entry(candidate);
+  if(entry != NULL){
+    free_resolution(&entry->value);
+    entry->value = resolution;
+  } else {
+    shput(resolved, candidate, resolution);
+  }
+  MUTEX_UNLOCK(&resolveMutex);
+  return found;
+}
+
+void wrt_resolve_cache_set_interval(uint64_t intervalUs){
+  MUTEX_LOCK(&resolveMutex);
+  revalidateInterval = intervalUs;
+  MUTEX_UNLOCK(&resolveMutex);
+}
+
+void wrt_resolve_cache_clear(void){
+  MUTEX_LOCK(&resolveMutex);
+  for (int i = 0; i < shlen(resolved); i++)
+  {
+    free_resolution(&resolved[i].value);
+  }
+  shfree(resolved);
+  sh_new_strdup(resolved);
+  MUTEX_UNLOCK(&resolveMutex);
+}
@@ -0,0 +1,21 @@
+#ifndef WRT_RESOLVE_CACHE_H
+#define WRT_RESOLVE_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Where installed modules were found under each root, including the ones
+// that were not, shared by all VMs. Entries are trusted until the
+// revalidation interval passes and then only probed again when the directory
+// they were searched in changed.
+void wrt_resolve_cache_init(void);
+void wrt_resolve_cache_before_fork(void);
+void wrt_resolve_cache_after_fork(void);
+// Fills wrenPath and binaryPath, both PATH_MAX buffers. binaryPath is left
+// empty when the module has no binary part. Returns false when the module is
+// not installed under root.
+bool wrt_resolve_cache_lookup(const char* root, const char* name, char* wrenPath, char* binaryPath);
+void wrt_resolve_cache_set_interval(uint64_t intervalUs);
+void wrt_resolve_cache_clear(void);
+
+#endif
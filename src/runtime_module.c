@@ -0,0 +1,44 @@
+#include <wren_runtime.h>
+
+#include "runtime_module.h"
+
+static const char* runtimeModuleSource =
+  "class Memory {\n"
+  "  foreign static current\n"
+  "  foreign static peak\n"
+  "  foreign static quota\n"
+  "  foreign static check()\n"
+  "}\n";
+
+WREN_METHOD(memory_current){
+  WrtMemoryStats stats;
+  wrt_get_memory_stats(vm, &stats);
+  wrenSetSlotDouble(vm, 0, (double)stats.current);
+}
+
+WREN_METHOD(memory_peak){
+  WrtMemoryStats stats;
+  wrt_get_memory_stats(vm, &stats);
+  wrenSetSlotDouble(vm, 0, (double)stats.peak);
+}
+
+WREN_METHOD(memory_quota){
+  WrtMemoryStats stats;
+  wrt_get_memory_stats(vm, &stats);
+  wrenSetSlotDouble(vm, 0, (double)stats.quota);
+}
+
+WREN_METHOD(memory_check){
+  wrenSetSlotBool(vm, 0, wrt_check_memory_quota(vm));
+}
+
+const char* wrt_runtime_module_source(void){
+  return runtimeModuleSource;
+}
+
+void wrt_bind_runtime_module(void){
+  wrt_bind_method(RUNTIME_MODULE ".Memory.current", memory_current);
+  wrt_bind_method(RUNTIME_MODULE ".Memory.peak", memory_peak);
+  wrt_bind_method(RUNTIME_MODULE ".Memory.quota", memory_quota);
+  wrt_bind_method(RUNTIME_MODULE ".Memory.check()", memory_check);
+}
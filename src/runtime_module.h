@@ -0,0 +1,10 @@
+#ifndef WRT_RUNTIME_MODULE_H
+#define WRT_RUNTIME_MODULE_H
+
+// Built-in module exposing the runtime to scripts: import "runtime" for Memory
+#define RUNTIME_MODULE "runtime"
+
+const char* wrt_runtime_module_source(void);
+void wrt_bind_runtime_module(void);
+
+#endif
@@ -0,0 +1,78 @@
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+
+#include "thread.h"
+
+typedef struct {
+    ThreadFn fn;
+    void* arg;
+} ThreadStart;
+
+#if defined(__unix__)
+static void* thread_main(void* data)
+#elif defined(_WIN32)
+static unsigned __stdcall thread_main(void* data)
+#endif
+{
+    ThreadStart start = *(ThreadStart*)data;
+    free(data);
+    start.fn(start.arg);
+    return 0;
+}
+
+int THREAD_START(THREAD *thread, ThreadFn fn, void* arg)
+{
+    ThreadStart* start = malloc(sizeof(ThreadStart));
+    start->fn = fn;
+    start->arg = arg;
+    #if defined(__unix__)
+        int result = pthread_create(thread, NULL, thread_main, start);
+        if(result == 0) pthread_detach(*thread);
+        else free(start);
+        return result;
+    #elif defined(_WIN32)
+        *thread = (HANDLE)_beginthreadex(NULL, 0, thread_main, start, 0, NULL);
+        if(*thread == 0){
+            free(start);
+            return 1;
+        }
+        CloseHandle(*thread);
+        return 0;
+    #endif
+    return -1;
+}
+
+int SEMAPHORE_INIT(SEMAPHORE *semaphore)
+{
+    #if defined(__unix__)
+        return sem_init(semaphore, 0, 0);
+    #elif defined(_WIN32)
+        *semaphore = CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+        return (*semaphore==0);
+    #endif
+    return -1;
+}
+
+int SEMAPHORE_POST(SEMAPHORE *semaphore)
+{
+    #if defined(__unix__)
+        return sem_post(semaphore);
+    #elif defined(_WIN32)
+        return (ReleaseSemaphore(*semaphore, 1, NULL)==0);
+    #endif
+    return -1;
+}
+
+int SEMAPHORE_WAIT(SEMAPHORE *semaphore)
+{
+    #if defined(__unix__)
+        while(sem_wait(semaphore) != 0){
+            if(errno != EINTR) return 1;
+        }
+        return 0;
+    #elif defined(_WIN32)
+        return (WaitForSingleObject(*semaphore, INFINITE)==WAIT_FAILED?1:0);
+    #endif
+    return -1;
+}
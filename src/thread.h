@@ -0,0 +1,31 @@
+#ifndef thread_h
+#define thread_h
+
+//Headers
+#if defined(__unix__)
+    #include <pthread.h>
+    #include <semaphore.h>
+#elif defined(_WIN32)
+    #include <windows.h>
+    #include <process.h>
+#endif
+
+//Data types
+#if defined(__unix__)
+    #define THREAD pthread_t
+    #define SEMAPHORE sem_t
+#elif defined(_WIN32)
+    #define THREAD HANDLE
+    #define SEMAPHORE HANDLE
+#endif
+
+typedef void (*ThreadFn)(void* arg);
+
+//Functions
+// Starts a detached thread, returns 0 on success
+int THREAD_START(THREAD *thread, ThreadFn fn, void* arg);
+int SEMAPHORE_INIT(SEMAPHORE *semaphore);
+int SEMAPHORE_POST(SEMAPHORE *semaphore);
+int SEMAPHORE_WAIT(SEMAPHORE *semaphore);
+
+#endif
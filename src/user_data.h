@@ -0,0 +1,42 @@
+#ifndef WRT_USER_DATA_H
+#define WRT_USER_DATA_H
+
+#include <setjmp.h>
+#include <wren.h>
+
+#include "event_loop.h"
+#include "allocator.h"
+#include "gc.h"
+#include "call_cache.h"
+#include "output.h"
+
+// Per-VM runtime state, stored as the VM's user data
+typedef struct {
+  bool isMainThread;
+  int numPluginData;
+  void** pluginData; 
+  // Plugin data as it was when a pooled VM finished warming up
+  int numCleanPluginData;
+  void** cleanPluginData;
+  WrtLoop* loop;
+  // stb_ds array of legacy update callbacks
+  WrenForeignMethodFn* updateCallbacks;
+  // NULL when the VM uses the system allocator
+  WrtArena* arena;
+  // Bytes the VM holds through reallocate_fn, 0 quota means unlimited
+  size_t currentBytes;
+  size_t peakBytes;
+  size_t memoryQuota;
+  // Set once an allocation went past the quota, cleared when it is back under
+  bool overQuota;
+  // Where wrt_interpret or wrt_call unwinds to when the quota reserve runs
+  // out, NULL while no Wren code runs through them
+  jmp_buf* quotaGuard;
+  // Stopped in the middle of Wren code, the VM can only be freed
+  bool halted;
+  WrtGC gc;
+  WrtCallCache calls;
+  WrtOutput output;
+} WrenUserData;
+
+#endif
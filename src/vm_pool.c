@@ -0,0 +1,142 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <wren_runtime.h>
+#include <stb_ds.h>
+
+#include "mutex.h"
+#include "user_data.h"
+#include "log.h"
+
+// Warm modules are imported from a module named like a file in the working
+// directory, so relative names resolve from there and the importer is never
+// looked up in the module sources
+#define POOL_MODULE "./wrt_pool"
+
+struct WrtVMPool {
+  MUTEX mutex;
+  int size;
+  int numIdle;
+  WrenVM** idle;
+  int numModules;
+  char** modules;
+  // Every pooled VM is created with it and handlers get its limits back
+  WrtVMConfig config;
+};
+
+static void mark_clean(WrenVM* vm){
+  WrenUserData* ud = (WrenUserData*)wrenGetUserData(vm);
+  free(ud->cleanPluginData);
+  ud->cleanPluginData = NULL;
+  ud->numCleanPluginData = ud->numPluginData;
+  if(ud->numPluginData > 0){
+    ud->cleanPluginData = malloc(ud->numPluginData * sizeof(void*));
+    memcpy(ud->cleanPluginData, ud->pluginData, ud->numPluginData * sizeof(void*));
+  }
+}
+
+// Puts back what the plugins set up while the warm modules were imported and
+// drops everything a handler registered on the VM's event loop or as an
+// update callback, along with the receivers wrt_call cached. Output, the
+// memory quota and the idle GC budget go back to the pool's settings, the
+// peak and GC statistics start over from the current heap. Plugins first
+// imported by a handler stay loaded on the VM and keep their data, their
+// per-VM init does not run again. Module level variables keep whatever
+// values the handler left there.
+static void reset_to_clean(WrtVMPool* pool, WrenVM* vm){
+  WrenUserData* ud = (WrenUserData*)wrenGetUserData(vm);
+  wrt_set_output_fd(vm, 1);
+  for (int i = 0; i < ud->numCleanPluginData && i < ud->numPluginData; i++)
+  {
+    ud->pluginData[i] = ud->cleanPluginData[i];
+  }
+  ud->memoryQuota = pool->config.memoryQuota;
+  ud->gc.idleBudgetUs = pool->config.idleGCBudgetUs;
+  if(ud->loop != NULL){
+    wrt_loop_free(ud->loop);
+    ud->loop = NULL;
+  }
+  arrsetlen(ud->updateCallbacks, 0);
+  wrt_call_cache_free(&ud->calls, vm);
+  ud->peakBytes = ud->currentBytes;
+  memset(&ud->gc.stats, 0, sizeof(ud->gc.stats));
+}
+
+static WrenVM* new_warm_vm(WrtVMPool* pool){
+  WrenVM* vm = wrt_new_wren_vm_with_config(&pool->config);
+  if(pool->numModules > 0){
+    if(wrt_import_modules(vm, POOL_MODULE, (const char**)pool->modules, pool->numModules) != WREN_RESULT_SUCCESS){
+      WRT_ERROR("Could not import the warm modules of a pooled VM");
+    }
+  }
+  mark_clean(vm);
+  return vm;
+}
+
+WrtVMPool* wrt_new_vm_pool(int size, const WrtVMConfig* config, const char** modules, int numModules){
+  WrtVMPool* pool = calloc(1, sizeof(WrtVMPool));
+  MUTEX_INIT(&pool->mutex);
+  pool->size = size;
+  if(config != NULL){
+    pool->config = *config;
+  } else {
+    wrt_init_vm_config(&pool->config);
+  }
+  pool->idle = calloc(size > 0 ? size : 1, sizeof(WrenVM*));
+
+  pool->numModules = numModules;
+  pool->modules = calloc(numModules > 0 ? numModules : 1, sizeof(char*));
+  for (int i = 0; i < numModules; i++)
+  {
+    pool->modules[i] = malloc(strlen(modules[i]) + 1);
+    strcpy(pool->modules[i], modules[i]);
+  }
+
+  for (int i = 0; i < size; i++)
+  {
+    pool->idle[pool->numIdle++] = new_warm_vm(pool);
+  }
+  return pool;
+}
+
+WrenVM* wrt_vm_pool_acquire(WrtVMPool* pool){
+  MUTEX_LOCK(&pool->mutex);
+  WrenVM* vm = pool->numIdle > 0 ? pool->idle[--pool->numIdle] : NULL;
+  MUTEX_UNLOCK(&pool->mutex);
+  // An exhausted pool hands out extra VMs, they are freed again on release
+  return vm != NULL ? vm : new_warm_vm(pool);
+}
+
+void wrt_vm_pool_release(WrtVMPool* pool, WrenVM* vm){
+  WrenUserData* ud = (WrenUserData*)wrenGetUserData(vm);
+  // A VM stopped by its quota can not run again
+  if(ud->halted){
+    wrt_free_wren_vm(vm);
+    return;
+  }
+  reset_to_clean(pool, vm);
+  MUTEX_LOCK(&pool->mutex);
+  bool kept = pool->numIdle < pool->size;
+  if(kept){
+    pool->idle[pool->numIdle++] = vm;
+  }
+  MUTEX_UNLOCK(&pool->mutex);
+  if(!kept){
+    wrt_free_wren_vm(vm);
+  }
+}
+
+void wrt_free_vm_pool(WrtVMPool* pool){
+  for (int i = 0; i < pool->numIdle; i++)
+  {
+    wrt_free_wren_vm(pool->idle[i]);
+  }
+  for (int i = 0; i < pool->numModules; i++)
+  {
+    free(pool->modules[i]);
+  }
+  free(pool->idle);
+  free(pool->modules);
+  free(pool);
+}
@@ -1,9 +1,15 @@
 #include <stdio.h>
+#include <stdarg.h>
 #include <assert.h>
 #include <string.h>
 #include <limits.h>
+#include <setjmp.h>
+#if defined(__unix__)
+  #include <unistd.h>
+#endif
 
 #include <wren.h>
+#include <cwalk.h>
 
 #include <wren_runtime.h>
 
@@ -14,21 +20,27 @@
 #include "os_call.h"
 #include "mutex.h"
 #include "modules.h"
+#include "event_loop.h"
+#include "module_cache.h"
+#include "resolve_cache.h"
+#include "canonical.h"
+#include "embedded.h"
+#include "loader.h"
+#include "imports.h"
+#include "prefetch.h"
+#include "bindings.h"
+#include "atomic.h"
+#include "user_data.h"
+#include "runtime_module.h"
+#include "log.h"
 
 MUTEX mutex;
-const char* moduleRoot;
 
 typedef struct {
   char* key;
   void* value;
 } WrenPluginData;
 
-typedef struct {
-  bool isMainThread;
-  int numPluginData;
-  void** pluginData; 
-} WrenUserData;
-
 void wrt_set_plugin_data(WrenVM* vm, int handle, void* value){
   WrenUserData* ud = (WrenUserData*)wrenGetUserData(vm);
   if(ud->numPluginData < handle){
@@ -46,57 +58,260 @@ void* wrt_get_plugin_data(WrenVM* vm, int handle){
   return ud->pluginData[handle- 1];
 }
 
+// The system allocator does not report block sizes, blocks carry their own
+#define SIZE_HEADER 16
+
+// Past its quota a VM may allocate this share of it more before it is
+// stopped in the middle of Wren code
+#define QUOTA_RESERVE_DIVISOR 8
+#define MIN_QUOTA_RESERVE (64 * 1024)
+
+static size_t block_size(WrenUserData* ud, void* memory){
+  if(memory == NULL) return 0;
+  if(ud->arena != NULL) return wrt_arena_size(ud->arena, memory);
+  return *(size_t*)((char*)memory - SIZE_HEADER);
+}
+
+static void* vm_allocate(WrenUserData* ud, void* memory, size_t newSize){
+  size_t oldSize = block_size(ud, memory);
+  void* result;
+  if(ud->arena != NULL){
+    result = wrt_arena_realloc(ud->arena, memory, newSize);
+    if(result == NULL && newSize > 0) return NULL;
+    if(result != NULL) newSize = wrt_arena_size(ud->arena, result);
+  } else {
+    size_t* block = memory != NULL ? (size_t*)((char*)memory - SIZE_HEADER) : NULL;
+    if(newSize == 0){
+      free(block);
+      result = NULL;
+    } else {
+      block = realloc(block, newSize + SIZE_HEADER);
+      if(block == NULL) return NULL;
+      *block = newSize;
+      result = (char*)block + SIZE_HEADER;
+    }
+  }
+  ud->currentBytes += newSize - oldSize;
+  if(ud->currentBytes > ud->peakBytes){
+    ud->peakBytes = ud->currentBytes;
+  }
+  return result;
+}
+
+static bool over_quota(WrenUserData* ud){
+  return ud->memoryQuota > 0 && ud->currentBytes > ud->memoryQuota;
+}
+
+static void report_quota(WrenUserData* ud){
+  WRT_ERROR("Memory quota of %zu bytes exceeded, %zu bytes in use", ud->memoryQuota, ud->currentBytes);
+}
+
+static size_t quota_reserve(WrenUserData* ud){
+  size_t reserve = ud->memoryQuota / QUOTA_RESERVE_DIVISOR;
+  return reserve > MIN_QUOTA_RESERVE ? reserve : MIN_QUOTA_RESERVE;
+}
+
+// Wren can not handle a failed allocation. The first one that takes the VM
+// over its quota collects, if that does not help the VM is marked and
+// refused at the next wrt_interpret or wrt_call. One that would use up the
+// reserve on top of the quota as well unwinds out of Wren to the
+// wrt_interpret or wrt_call the VM runs in, which fail with a runtime error.
+static void check_quota(WrenUserData* ud, void* memory, size_t newSize){
+  size_t oldSize = block_size(ud, memory);
+  if(newSize <= oldSize) return;
+  size_t growth = newSize - oldSize;
+  if(ud->currentBytes + growth <= ud->memoryQuota){
+    ud->overQuota = false;
+    return;
+  }
+  if(!ud->overQuota){
+    wrt_gc_collect(&ud->gc, &ud->currentBytes);
+    if(ud->currentBytes + growth <= ud->memoryQuota) return;
+    ud->overQuota = true;
+  }
+  // Never from inside a collection the runtime started itself
+  if(ud->currentBytes + growth > ud->memoryQuota + quota_reserve(ud) && ud->quotaGuard != NULL && !ud->gc.collecting){
+    ud->halted = true;
+    longjmp(*ud->quotaGuard, 1);
+  }
+}
+
+// Wren itself collects at the same point, right before an allocation
+static void* reallocate_fn(void* memory, size_t newSize, void* userData){
+  WrenUserData* ud = (WrenUserData*)userData;
+  if(newSize > 0 && wrt_gc_due(&ud->gc, ud->currentBytes)){
+    wrt_gc_collect(&ud->gc, &ud->currentBytes);
+  }
+  if(newSize > 0 && ud->memoryQuota > 0){
+    check_quota(ud, memory, newSize);
+  }
+  return vm_allocate(ud, memory, newSize);
+}
+
+// Stops the VM where the runtime can do it safely, after a collection had
+// the chance to bring it back under its quota
+static bool enforce_quota(WrenVM* vm){
+  WrenUserData* ud = (WrenUserData*)wrenGetUserData(vm);
+  if(ud->halted) return false;
+  if(!over_quota(ud)) return true;
+  wrt_gc_collect(&ud->gc, &ud->currentBytes);
+  ud->overQuota = over_quota(ud);
+  if(!ud->overQuota) return true;
+  report_quota(ud);
+  return false;
+}
+
+bool wrt_check_memory_quota(WrenVM* vm){
+  if(enforce_quota(vm)) return true;
+  wrenEnsureSlots(vm, 1);
+  wrenSetSlotString(vm, 0, "Memory quota exceeded.");
+  wrenAbortFiber(vm, 0);
+  return false;
+}
+
+void wrt_set_memory_quota(WrenVM* vm, size_t bytes){
+  WrenUserData* ud = (WrenUserData*)wrenGetUserData(vm);
+  ud->memoryQuota = bytes;
+}
+
+void wrt_get_memory_stats(WrenVM* vm, WrtMemoryStats* stats){
+  WrenUserData* ud = (WrenUserData*)wrenGetUserData(vm);
+  stats->current = ud->currentBytes;
+  stats->peak = ud->peakBytes;
+  stats->quota = ud->memoryQuota;
+}
+
+void wrt_collect_garbage(WrenVM* vm){
+  WrenUserData* ud = (WrenUserData*)wrenGetUserData(vm);
+  wrt_gc_collect(&ud->gc, &ud->currentBytes);
+}
+
+void wrt_get_gc_stats(WrenVM* vm, WrtGCStats* stats){
+  WrenUserData* ud = (WrenUserData*)wrenGetUserData(vm);
+  *stats = ud->gc.stats;
+  stats->heapGrowthPercent = ud->gc.growthPercent;
+}
+
+void wrt_set_idle_gc_budget(WrenVM* vm, uint64_t budgetUs){
+  WrenUserData* ud = (WrenUserData*)wrenGetUserData(vm);
+  ud->gc.idleBudgetUs = budgetUs;
+}
+
 static const void error_fn(WrenVM *vm, WrenErrorType type, const char *module, int line, const char *message)
 {  
-  printf("Wren-Error in module '%s' line %i: %s\n", module, line, message);
+  // Errors go through the VM's output so they stay in order with its prints
+  WrenUserData* ud = (WrenUserData*)wrenGetUserData(vm);
+  char location[256];
+  snprintf(location, sizeof(location), "Wren-Error in module '%s' line %i: ", module, line);
+  wrt_output_write(&ud->output, vm, location);
+  wrt_output_write(&ud->output, vm, message);
+  wrt_output_write(&ud->output, vm, "\n");
 }
 
 static const void write_fn(WrenVM *vm, const char *text)
 {
-  printf("%s", text);
+  WrenUserData* ud = (WrenUserData*)wrenGetUserData(vm);
+  wrt_output_write(&ud->output, vm, text);
 }
 
-typedef struct {
-  char * key;
-  WrenForeignMethodFn value;
-} Binding;
+void wrt_set_output_fd(WrenVM* vm, int fd){
+  WrenUserData* ud = (WrenUserData*)wrenGetUserData(vm);
+  wrt_output_flush(&ud->output, vm);
+  ud->output.fd = fd;
+  ud->output.fn = NULL;
+}
 
-typedef struct {
-  char* key;
-  WrenForeignClassMethods value;
-} ClassBinding;
+void wrt_set_output_callback(WrenVM* vm, WrtOutputFn fn, void* data){
+  WrenUserData* ud = (WrenUserData*)wrenGetUserData(vm);
+  wrt_output_flush(&ud->output, vm);
+  ud->output.fn = fn;
+  ud->output.data = data;
+}
 
-typedef struct {
-  void* wrenInitFunc;
-} BinaryModuleData;
+void wrt_flush_output(WrenVM* vm){
+  WrenUserData* ud = (WrenUserData*)wrenGetUserData(vm);
+  wrt_output_flush(&ud->output, vm);
+}
+
+#define INITIAL_PLUGIN_SLOTS 64
+
+typedef enum {
+  PLUGIN_UNLOADED,
+  PLUGIN_READY
+} PluginState;
 
 typedef struct {
-  char* key;
-  BinaryModuleData value;
+  const char* name;
+  uint64_t hash;
+  int state;
+  MUTEX loadMutex;
+  void* wrenInitFunc;
 } BinaryModule;
 
-static Binding* bindings = NULL;
-static ClassBinding* classBindings = NULL;
-static BinaryModule* binaryModules = NULL;
+// Plugins live in an open-addressed table of pointers. Slots are claimed
+// under the global mutex and published once the plugin is set up, so lookups
+// of an already registered plugin never take a lock. A table that is half
+// full is copied into one twice its size and published in its place.
+typedef struct PluginTable {
+  uint32_t capacity;
+  uint32_t count;
+  // Replaced tables are not freed, lookups may still walk them
+  const struct PluginTable* previous;
+  BinaryModule* slots[];
+} PluginTable;
 
-static char* getMethodName(const char* module, 
-  const char* className, 
-  bool isStatic, 
-  const char* signature)
-{
-  int length = strlen(module) + strlen(className) + strlen(signature) + 3;
-  char *str = (char*)malloc(length);
-  sprintf(str, "%s.%s.%s", module, className, signature);
-  return str;
+// Every registration ends up in the full tables. VMs look bindings up in the
+// sealed perfect hash tables without locking, registrations made since the
+// last seal are kept in the late tables until the next seal picks them up.
+// While there are late registrations they are looked up first, so a rebind
+// wins over the stale sealed entry.
+static MUTEX bindingsMutex;
+static WrtBindingTable bindings = {0};
+static WrtBindingTable classBindings = {0};
+static WrtBindingTable lateBindings = {0};
+static WrtBindingTable lateClassBindings = {0};
+static WrtSealedBindings* sealedBindings = NULL;
+static WrtSealedBindings* sealedClassBindings = NULL;
+static int numLateBindings = 0;
+// Replaced tables are freed by a later seal once no lookup is probing a
+// sealed table
+static WrtSealedBindings* retiredBindings = NULL;
+static int sealedReaders = 0;
+// Sizes of the full tables when sealing them last failed, a seal is only
+// retried once more bindings were registered
+#define SEAL_NOT_FAILED UINT32_MAX
+static uint32_t failedSeal = SEAL_NOT_FAILED;
+static uint32_t failedClassSeal = SEAL_NOT_FAILED;
+static PluginTable* plugins = NULL;
+
+static bool find_binding(WrtSealedBindings** sealed, WrtBindingTable* late, const char** parts, int numParts, WrtBinding* found){
+  uint64_t hash = wrt_binding_hash(parts, numParts);
+  const WrtBinding* binding;
+  if(ATOMIC_LOAD_INT(&numLateBindings) == 0){
+    ATOMIC_FETCH_ADD_INT(&sealedReaders, 1);
+    binding = wrt_sealed_find(ATOMIC_LOAD_PTR(sealed), hash, parts, numParts);
+    if(binding != NULL){
+      *found = *binding;
+    }
+    ATOMIC_FETCH_ADD_INT(&sealedReaders, -1);
+    if(binding != NULL) return true;
+  }
+  // Slow path, the sealed table may have been replaced while we were probing it
+  MUTEX_LOCK(&bindingsMutex);
+  binding = wrt_binding_table_find(late, hash, parts, numParts);
+  if(binding == NULL){
+    binding = wrt_sealed_find(*sealed, hash, parts, numParts);
+  }
+  if(binding != NULL){
+    *found = *binding;
+  }
+  MUTEX_UNLOCK(&bindingsMutex);
+  return binding != NULL;
 }
 
-static char* getClassName(const char* module, 
-  const char* className)
-{
-  int length = strlen(module) + strlen(className) + 2;
-  char *str = (char*)malloc(length);
-  sprintf(str, "%s.%s", module, className);
-  return str;
+// Called with bindingsMutex held
+static void count_late_bindings(void){
+  ATOMIC_STORE_INT(&numLateBindings, (int)(lateBindings.count + lateClassBindings.count));
 }
 
 static WrenForeignMethodFn bind_method_fn( 
@@ -106,13 +321,9 @@ static WrenForeignMethodFn bind_method_fn(
   bool isStatic, 
   const char* signature) 
 {
-  if(strcmp(module, "random") == 0 || strcmp(module, "meta") == 0){
-    return NULL;
-  }
-  char* fullName = getMethodName(module, className, isStatic, signature);
-  WrenForeignMethodFn func = shget(bindings, fullName);
-  free(fullName);
-  return func;
+  const char* parts[] = { module, className, signature };
+  WrtBinding binding;
+  return find_binding(&sealedBindings, &lateBindings, parts, 3, &binding) ? binding.fn : NULL;
 }
 
 WrenForeignClassMethods bind_class_fn( 
@@ -120,204 +331,566 @@ WrenForeignClassMethods bind_class_fn(
   const char* module, 
   const char* className)
 {
-  if(strcmp(module, "random") == 0 || strcmp(module, "meta") == 0){
-    WrenForeignClassMethods wfcm ={0};
-    return wfcm;
+  WrenForeignClassMethods wfcm = {0};
+  const char* parts[] = { module, className };
+  WrtBinding binding;
+  if(find_binding(&sealedClassBindings, &lateClassBindings, parts, 2, &binding)){
+    wfcm.allocate = binding.fn;
+    wfcm.finalize = binding.finalizer;
   }
+  return wfcm;
+}
 
-  char* fullName = getClassName(module, className);
-  
-  int index = shgeti(classBindings, fullName);
-  free(fullName);
-  if(index == -1){
-    WrenForeignClassMethods wfcm ={0};
-    return wfcm;  
-  }
-  else {
-    return classBindings[index].value;
+void wrt_bind_method(const char* name, WrenForeignMethodFn func){
+  uint64_t hash = wrt_binding_hash_string(name);
+  MUTEX_LOCK(&bindingsMutex);
+  wrt_binding_table_put(&bindings, hash, name, func, NULL);
+  wrt_binding_table_put(&lateBindings, hash, name, func, NULL);
+  count_late_bindings();
+  MUTEX_UNLOCK(&bindingsMutex);
+}
+
+void wrt_bind_methods(const WrtMethodBinding* methods, int count){
+  MUTEX_LOCK(&bindingsMutex);
+  for (int i = 0; i < count; i++)
+  {
+    wrt_binding_table_put(&bindings, methods[i].hash, methods[i].name, methods[i].fn, NULL);
+    wrt_binding_table_put(&lateBindings, methods[i].hash, methods[i].name, methods[i].fn, NULL);
   }
+  count_late_bindings();
+  MUTEX_UNLOCK(&bindingsMutex);
 }
 
+void wrt_bind_class(const char* name, WrenForeignMethodFn allocator, WrenFinalizerFn finalizer){
+  uint64_t hash = wrt_binding_hash_string(name);
+  MUTEX_LOCK(&bindingsMutex);
+  wrt_binding_table_put(&classBindings, hash, name, allocator, finalizer);
+  wrt_binding_table_put(&lateClassBindings, hash, name, allocator, finalizer);
+  count_late_bindings();
+  MUTEX_UNLOCK(&bindingsMutex);
+}
 
+// Called with bindingsMutex held. On failure the late table is kept and
+// looked up under the lock.
+static void seal_table(WrtSealedBindings** sealed, WrtBindingTable* full, WrtBindingTable* late, uint32_t* failed){
+  if(late->count == 0 && *sealed != NULL) return;
+  if(*failed == full->count) return;
+  WrtSealedBindings* table = wrt_binding_seal(full);
+  if(table == NULL){
+    WRT_WARN("Could not seal %u bindings, retrying after the next registration", full->count);
+    *failed = full->count;
+    return;
+  }
+  *failed = SEAL_NOT_FAILED;
+  WrtSealedBindings* old = *sealed;
+  ATOMIC_STORE_PTR(sealed, table);
+  if(old != NULL){
+    old->next = retiredBindings;
+    retiredBindings = old;
+  }
+  wrt_binding_table_free(late);
+}
 
-void wrt_bind_method(const char* name, WrenForeignMethodFn func){
-  shput(bindings, name, func);
+// Called with bindingsMutex held. A lookup that starts after the tables
+// were replaced only sees the new ones.
+static void free_retired_bindings(void){
+  if(retiredBindings == NULL || ATOMIC_FETCH_ADD_INT(&sealedReaders, 0) != 0) return;
+  while(retiredBindings != NULL){
+    WrtSealedBindings* table = retiredBindings;
+    retiredBindings = table->next;
+    wrt_sealed_free(table);
+  }
 }
 
-void wrt_bind_class(const char* name, WrenForeignMethodFn allocator, WrenFinalizerFn finalizer){
-  WrenForeignClassMethods methods = {
-    allocator = allocator,
-    finalizer = finalizer
-  };
-  shput(classBindings, name, methods);
-}
-
-struct WrenCallbackNode {
-  WrenForeignMethodFn callback;
-  struct WrenCallbackNode* next;
-};
-typedef struct WrenCallbackNode WrenCallbackNode;
-typedef struct {
-  WrenCallbackNode* start;
-  WrenCallbackNode* end;
-}  WrenCallbackList;
+void wrt_seal_bindings(){
+  MUTEX_LOCK(&bindingsMutex);
+  seal_table(&sealedBindings, &bindings, &lateBindings, &failedSeal);
+  seal_table(&sealedClassBindings, &classBindings, &lateClassBindings, &failedClassSeal);
+  count_late_bindings();
+  free_retired_bindings();
+  MUTEX_UNLOCK(&bindingsMutex);
+}
 
-static WrenCallbackList updateCallbacks;
+void wrt_wren_update_callback(WrenVM* vm, WrenForeignMethodFn fn){
+  WrenUserData* ud = (WrenUserData*)wrenGetUserData(vm);
+  arrput(ud->updateCallbacks, fn);
+}
 
-static void callbacks_push(WrenCallbackList* list, WrenCallbackNode* node){
-  if(list->start == NULL && list->end == NULL){
-      list->start = node;
-      list->end = node;
-  } else {
-    list->end->next = node;
+// A callback that leaves false in slot 0 is removed. The last one is swapped
+// into its place and still runs in this pass.
+static void call_update_callbacks_once(WrenVM* vm){
+  WrenUserData* ud = (WrenUserData*)wrenGetUserData(vm);
+  int i = 0;
+  while(i < arrlen(ud->updateCallbacks)){
+    ud->updateCallbacks[i](vm);
+    if(!wrenGetSlotBool(vm, 0)){
+      arrdelswap(ud->updateCallbacks, i);
+    } else {
+      i++;
+    }
+  }
+}
+
+static WrtLoop* get_loop(WrenVM* vm){
+  WrenUserData* ud = (WrenUserData*)wrenGetUserData(vm);
+  if(ud->loop == NULL){
+    ud->loop = wrt_loop_new(vm);
   }
+  return ud->loop;
+}
+
+WrtLoopWatch* wrt_loop_watch_fd(WrenVM* vm, int fd, int events, WrtLoopFdFn fn, void* data){
+  WrtLoop* loop = get_loop(vm);
+  return loop != NULL ? wrt_loop_new_fd_watch(loop, fd, events, fn, data) : NULL;
+}
+
+WrtLoopWatch* wrt_loop_add_timer(WrenVM* vm, uint64_t delayUs, uint64_t intervalUs, WrtLoopFn fn, void* data){
+  WrtLoop* loop = get_loop(vm);
+  return loop != NULL ? wrt_loop_new_timer(loop, delayUs, intervalUs, fn, data) : NULL;
 }
 
-void wrt_wren_update_callback(WrenForeignMethodFn fn){
-  WrenCallbackNode* cb = malloc(sizeof(WrenCallbackNode));
-  cb->callback = fn;
-  cb->next = NULL;
+WrtLoopWatch* wrt_loop_add_wakeup(WrenVM* vm, WrtLoopFn fn, void* data){
+  WrtLoop* loop = get_loop(vm);
+  return loop != NULL ? wrt_loop_new_wakeup(loop, fn, data) : NULL;
+}
 
-  callbacks_push(&updateCallbacks, cb);
+void wrt_loop_signal(WrtLoopWatch* wakeup){
+  wrt_loop_signal_wakeup(wakeup);
+}
+
+void wrt_loop_remove(WrenVM* vm, WrtLoopWatch* watch){
+  WrenUserData* ud = (WrenUserData*)wrenGetUserData(vm);
+  if(ud->loop != NULL){
+    wrt_loop_remove_watch(ud->loop, watch);
+  }
+}
+
+void wrt_loop_stop(WrenVM* vm){
+  WrenUserData* ud = (WrenUserData*)wrenGetUserData(vm);
+  if(ud->loop != NULL){
+    wrt_loop_request_stop(ud->loop);
+  }
 }
 
+// Legacy update callbacks are polled this often, the loop blocks in between
+#define UPDATE_CALLBACK_INTERVAL_US 1000
+
 void wrt_call_update_callbacks(WrenVM* vm) {
-  while(updateCallbacks.start != NULL){
-    WrenCallbackNode* current = updateCallbacks.start;
-    WrenCallbackNode* prev = NULL;
-    while(current != NULL){
-      current->callback(vm);
-      if(!wrenGetSlotBool(vm, 0)){
-        if(current == updateCallbacks.end){
-          updateCallbacks.end = prev;
-        }      
-        if(prev == NULL){
-          updateCallbacks.start = current->next;        
-        } else {
-          prev->next = current->next;
-        }
-        WrenCallbackNode* remove = current;
-        current = current->next;
-        free(remove);
+  WrenUserData* ud = (WrenUserData*)wrenGetUserData(vm);
+  uint64_t nextUpdate = 0;
+  while(true){
+    if(!enforce_quota(vm)) break;
+    if(arrlen(ud->updateCallbacks) > 0 && wrt_clock_us() >= nextUpdate){
+      call_update_callbacks_once(vm);
+      nextUpdate = wrt_clock_us() + UPDATE_CALLBACK_INTERVAL_US;
+    }
+    bool polling = arrlen(ud->updateCallbacks) > 0;
+    bool waiting = ud->loop != NULL && wrt_loop_alive(ud->loop);
+    if(!polling && !waiting) break;
+    if(ud->loop != NULL && wrt_loop_take_stop(ud->loop)) break;
+    if(wrt_gc_idle_due(&ud->gc, ud->currentBytes)){
+      // Collect between frames or while nothing is ready, so the pause does
+      // not land in the middle of a handler
+      if(!waiting || wrt_loop_run_once(ud->loop, 0) == 0){
+        wrt_gc_collect(&ud->gc, &ud->currentBytes);
       }
+      continue;
+    }
+    int64_t timeout = -1;
+    if(polling){
+      uint64_t now = wrt_clock_us();
+      timeout = nextUpdate > now ? (int64_t)(nextUpdate - now) : 0;
+    } else {
+      wrt_output_flush(&ud->output, vm);
+    }
+    if(waiting){
+      wrt_loop_run_once(ud->loop, timeout);
+    } else if(timeout > 0){
+      wrt_sleep_us((uint64_t)timeout);
     }
   }
+  wrt_output_flush(&ud->output, vm);
 }
 
 static int plugin_id = 1;
 
-#define LoadPluginAssert(assert, msg) if(!(assert)){ puts(msg); goto DONE; }
+#if defined(__unix__)
+#define FORK_WAIT_US 100
+
+// Loads hold their plugin's loadMutex, fork() waits for them to finish
+// behind loadGate instead. Only the outermost load of a thread counts, an
+// init function may register further plugins.
+static MUTEX loadGate;
+static int pluginLoads = 0;
+static __thread int loadDepth = 0;
 
-static void register_plugin(const char* name, WrtPluginInitFunc init){
-  printf("Register Plugin %s\n", name);
-  BinaryModuleData md;
-  md.wrenInitFunc = init(plugin_id++);
-  shput(binaryModules, name, md);
+static void begin_load(void){
+  if(loadDepth++ == 0){
+    MUTEX_LOCK(&loadGate);
+    ATOMIC_FETCH_ADD_INT(&pluginLoads, 1);
+    MUTEX_UNLOCK(&loadGate);
+  }
 }
 
-void wrt_register_plugin(const char* name, WrtPluginInitFunc init){
+static void end_load(void){
+  if(--loadDepth == 0) ATOMIC_FETCH_ADD_INT(&pluginLoads, -1);
+}
+#else
+static void begin_load(void){}
+static void end_load(void){}
+#endif
+
+#define LoadPluginAssert(assert, msg) if(!(assert)){ WRT_ERROR("%s", msg); goto DONE; }
+
+static BinaryModule* find_in_table(const PluginTable* table, const char* name, uint64_t hash){
+  uint32_t mask = table->capacity - 1;
+  uint32_t index = (uint32_t)hash & mask;
+  for (uint32_t i = 0; i < table->capacity; i++)
+  {
+    BinaryModule* plugin = ATOMIC_LOAD_PTR(&table->slots[index]);
+    if(plugin == NULL) return NULL;
+    if(plugin->hash == hash && strcmp(plugin->name, name) == 0) return plugin;
+    index = (index + 1) & mask;
+  }
+  return NULL;
+}
+
+static BinaryModule* find_plugin(const char* name, uint64_t hash){
+  PluginTable* table = ATOMIC_LOAD_PTR(&plugins);
+  while(table != NULL){
+    BinaryModule* plugin = find_in_table(table, name, hash);
+    if(plugin != NULL) return plugin;
+    // It may have gone into a larger table published meanwhile
+    PluginTable* current = ATOMIC_LOAD_PTR(&plugins);
+    if(current == table) return NULL;
+    table = current;
+  }
+  return NULL;
+}
+
+// Must be called with mutex held
+static void insert_plugin(PluginTable* table, BinaryModule* plugin){
+  uint32_t mask = table->capacity - 1;
+  uint32_t index = (uint32_t)plugin->hash & mask;
+  while(table->slots[index] != NULL){
+    index = (index + 1) & mask;
+  }
+  ATOMIC_STORE_PTR(&table->slots[index], plugin);
+  table->count++;
+}
+
+// Must be called with mutex held
+static PluginTable* new_plugin_table(const PluginTable* current){
+  uint32_t capacity = current != NULL ? current->capacity * 2 : INITIAL_PLUGIN_SLOTS;
+  PluginTable* table = calloc(1, sizeof(PluginTable) + capacity * sizeof(BinaryModule*));
+  table->capacity = capacity;
+  table->previous = current;
+  for (uint32_t i = 0; current != NULL && i < current->capacity; i++)
+  {
+    if(current->slots[i] != NULL) insert_plugin(table, current->slots[i]);
+  }
+  return table;
+}
+
+static BinaryModule* claim_plugin(const char* name){
+  uint64_t hash = wrt_binding_hash_string(name);
+  BinaryModule* plugin = find_plugin(name, hash);
+  if(plugin != NULL) return plugin;
+
   MUTEX_LOCK(&mutex);
-  printf("Load static binary module '%s'\n", name);
-  register_plugin(name, init);
+  plugin = find_plugin(name, hash);
+  if(plugin == NULL){
+    PluginTable* table = plugins;
+    if(table == NULL || (table->count + 1) * 2 > table->capacity){
+      table = new_plugin_table(table);
+      ATOMIC_STORE_PTR(&plugins, table);
+    }
+    plugin = calloc(1, sizeof(BinaryModule));
+    plugin->hash = hash;
+    MUTEX_INIT(&plugin->loadMutex);
+    char* copy = malloc(strlen(name) + 1);
+    strcpy(copy, name);
+    plugin->name = copy;
+    insert_plugin(table, plugin);
+  }
   MUTEX_UNLOCK(&mutex);
+  return plugin;
 }
 
-static void load_plugin(WrenVM* vm, const char * pluginname, const char * dllname){
-  MUTEX_LOCK(&mutex);
-  
-  char namebuffer[1024];
-  
-  int len = strlen(dllname);
-  char* name = malloc(sizeof(char)*len+1);
-  strcpy(name, dllname);
+// Must be called with the plugin's loadMutex held
+static void register_plugin(BinaryModule* plugin, WrtPluginInitFunc init){
+  WRT_DEBUG("Register Plugin %s", plugin->name);
+  plugin->wrenInitFunc = init(ATOMIC_FETCH_ADD_INT(&plugin_id, 1));
+  ATOMIC_STORE_INT(&plugin->state, PLUGIN_READY);
+}
 
-  int index = shgeti(binaryModules, pluginname);
-  if(index == -1){
-    printf("Load dynamic binary module '%s'\n", pluginname);
-    void* handle = wrt_dlopen(name);
-    LoadPluginAssert(handle != NULL, "Could not open binary plugin");
+void wrt_register_plugin(const char* name, WrtPluginInitFunc init){
+  BinaryModule* plugin = claim_plugin(name);
+  if(plugin == NULL) return;
+  begin_load();
+  MUTEX_LOCK(&plugin->loadMutex);
+  WRT_DEBUG("Load static binary module '%s'", name);
+  register_plugin(plugin, init);
+  MUTEX_UNLOCK(&plugin->loadMutex);
+  end_load();
+}
 
-    strcpy(namebuffer, "wrt_plugin_init_");
-    strcat(namebuffer, pluginname);
-    WrenForeignMethodFn (*initFunc)(int handle) = wrt_dlsym(handle, namebuffer);
-    LoadPluginAssert(initFunc != NULL, "Did not find init entry point in binary plugin");
+// Opens a dynamic plugin unless it is ready already, returns whether it is
+static bool open_plugin(BinaryModule* plugin, const char * pluginname, const char * dllname){
+  // Only the first importer opens the library, concurrent importers of the
+  // same plugin wait for it here while other plugins load in parallel
+  if(ATOMIC_LOAD_INT(&plugin->state) != PLUGIN_READY){
+    begin_load();
+    MUTEX_LOCK(&plugin->loadMutex);
+    if(plugin->state != PLUGIN_READY){
+      char namebuffer[1024];
+      WRT_DEBUG("Load dynamic binary module '%s'", pluginname);
+      void* handle = wrt_dlopen(dllname);
+      LoadPluginAssert(handle != NULL, "Could not open binary plugin");
 
-    register_plugin(pluginname, initFunc);
-    index = shgeti(binaryModules, pluginname);
-  }
-  else {
-    free(name);
+      strcpy(namebuffer, "wrt_plugin_init_");
+      strcat(namebuffer, pluginname);
+      WrenForeignMethodFn (*initFunc)(int handle) = wrt_dlsym(handle, namebuffer);
+      LoadPluginAssert(initFunc != NULL, "Did not find init entry point in binary plugin");
+
+      register_plugin(plugin, initFunc);
+    }
+    DONE:
+    MUTEX_UNLOCK(&plugin->loadMutex);
+    end_load();
   }
+  return ATOMIC_LOAD_INT(&plugin->state) == PLUGIN_READY;
+}
+
+static void load_plugin(WrenVM* vm, const char * pluginname, const char * dllname){
+  BinaryModule* plugin = claim_plugin(pluginname);
+  if(plugin == NULL || !open_plugin(plugin, pluginname, dllname)) return;
 
-  void* initFunc = binaryModules[index].value.wrenInitFunc;
+  // Per-VM initialization runs without holding any runtime lock
+  void* initFunc = plugin->wrenInitFunc;
   if(initFunc != NULL){
     void (*wrenInitFunc)(WrenVM*) = initFunc;
     wrenInitFunc(vm);
   }
+}
 
-  DONE:
-  MUTEX_UNLOCK(&mutex);
+// Opens a plugin ahead of its first import, without any per-VM init
+static void preload_plugin(const char * pluginname, const char * dllname){
+  BinaryModule* plugin = claim_plugin(pluginname);
+  if(plugin != NULL) open_plugin(plugin, pluginname, dllname);
+}
+
+static bool plugin_ready(const char* name){
+  BinaryModule* plugin = find_plugin(name, wrt_binding_hash_string(name));
+  return plugin != NULL && ATOMIC_LOAD_INT(&plugin->state) == PLUGIN_READY;
+}
+
+// Packaged modules only touch the filesystem for a binary part recorded in
+// their bundle, and only until its plugin is loaded
+static void locate_binary(const char* name, WrtFoundModule* found){
+  if(found->binaryPath[0] == 0 && found->hasBinary && !plugin_ready(name)){
+    wrt_loader_find_binary(name, found->binaryPath);
+  }
+}
+
+// Static plugins of packaged modules just get their per-VM init
+static void load_found_plugin(WrenVM* vm, const char* name, WrtFoundModule* found){
+  locate_binary(name, found);
+  if(found->binaryPath[0] != 0){
+    WRT_DEBUG("Load binary %s", found->binaryPath);
+    load_plugin(vm, name, found->binaryPath);
+  } else if(found->packaged && plugin_ready(name)){
+    load_plugin(vm, name, NULL);
+  }
+}
+
+static bool is_builtin_module(const char* name){
+  return strcmp(name, "random") == 0 || strcmp(name, "meta") == 0 || strcmp(name, RUNTIME_MODULE) == 0;
+}
+
+// Writes the name Wren knows the module by into a PATH_MAX buffer
+static void resolve_name(const char* importer, const char* name, char* canonical){
+  if(!wrt_is_file_module(name)){
+    cwk_path_normalize(name, canonical, PATH_MAX);
+    return;
+  }
+
+  // Installed modules are named without their path, relative imports in
+  // them start from where the module was found
+  const char* base = importer;
+  WrtFoundModule found;
+  if(!wrt_is_file_module(importer) && wrt_loader_find(importer, false, &found)){
+    if(!found.packaged){
+      base = found.path;
+    } else if(name[0] == '.'){
+      // Relative imports in a packaged module name other installed modules
+      size_t length;
+      cwk_path_get_dirname(importer, &length);
+      char joined[PATH_MAX];
+      memcpy(joined, importer, length);
+      joined[length] = 0;
+      cwk_path_join(joined, name, canonical, PATH_MAX);
+      if(wrt_loader_find(canonical, false, &found)) return;
+    }
+  }
+  const char** roots;
+  int numRoots = wrt_loader_roots(&roots);
+  const char* path = wrt_resolve_file_module(base, name);
+  wrt_canonical_file_module(roots, numRoots, path, canonical);
+  free((void*)path);
+}
+
+static void submit_import(const char* name, size_t length, void* data){
+  if(length >= PATH_MAX) return;
+  char imported[PATH_MAX];
+  memcpy(imported, name, length);
+  imported[length] = 0;
+  if(is_builtin_module(imported)) return;
+  char resolved[PATH_MAX];
+  resolve_name((const char*)data, imported, resolved);
+  wrt_prefetch_submit(resolved);
+}
+
+// Queues what source imports so it is loaded before the compiler gets there
+static void prefetch_imports(const char* name, const char* source){
+  if(!wrt_prefetch_enabled()) return;
+  wrt_scan_imports(source, submit_import, (void*)name);
+}
+
+// Runs on the prefetch threads: warms the source and plugin caches for a
+// resolved module and queues its own imports
+static void prefetch_module(const char* name){
+  if(wrt_is_file_module(name)){
+    WrtCachedSource* source = wrt_module_cache_acquire(name, false);
+    if(source != NULL){
+      prefetch_imports(name, source->text);
+      wrt_module_cache_release(source);
+    }
+    return;
+  }
+
+  WrtFoundModule found;
+  if(!wrt_loader_find(name, true, &found)) return;
+  locate_binary(name, &found);
+  if(found.binaryPath[0] != 0) preload_plugin(name, found.binaryPath);
+  prefetch_imports(name, found.source);
+  wrt_loader_release(&found);
+}
+
+static void load_module_complete(WrenVM* vm, const char* name, WrenLoadModuleResult result){
+  wrt_module_cache_release((WrtCachedSource*)result.userData);
 }
 
 static WrenLoadModuleResult load_module_fn(WrenVM* vm, const char* name){
   WrenLoadModuleResult result = {0};
-  const char* script = NULL;
+  WrtCachedSource* source = NULL;
 
   if(strcmp(name, "random") == 0 || strcmp(name, "meta") == 0){
     return result;
   }
 
+  // Failing the import aborts the importing fiber with a runtime error
+  WrenUserData* ud = (WrenUserData*)wrenGetUserData(vm);
+  if(over_quota(ud)){
+    report_quota(ud);
+    return result;
+  }
+
+  if(strcmp(name, RUNTIME_MODULE) == 0){
+    result.source = wrt_runtime_module_source();
+    return result;
+  }
+
   if(wrt_is_file_module(name)){
-    if(wrt_file_exists(name)){
-      script = wrt_read_file(name);
-    }
+    source = wrt_module_cache_acquire(name, false);
+    if(source != NULL) prefetch_imports(name, source->text);
   } else {
-    const char* module_path = wrt_resolve_installed_module(&moduleRoot, 1, name);
-    if(module_path == NULL) return result;
-    printf("Resolved installed module at %s\n", module_path);
-    if(wrt_file_exists(module_path)){
-      script = wrt_read_file(module_path);
-    }
-    
-    const char* binary_path = wrt_resolve_binary_module(module_path);
-    free((void*)module_path);
-    printf("Load binary %s\n", binary_path);
-    if(wrt_file_exists(binary_path)){
-      load_plugin(vm, name, binary_path);
-    }
-    free((void*)binary_path);
-  } 
-  result.source = script;
+    WrtFoundModule found;
+    if(!wrt_loader_find(name, true, &found)) return result;
+    WRT_DEBUG("Found installed module %s %s", name, found.path);
+    prefetch_imports(name, found.source);
+    load_found_plugin(vm, name, &found);
+    // Memory and bundle sources live as long as the process
+    result.source = found.source;
+    source = found.cached;
+  }
+  if(source != NULL){
+    result.source = source->text;
+    result.onComplete = load_module_complete;
+    result.userData = source;
+  }
   return result;
 }
 
+// Wren releases resolved module names with the VM's own allocator. This
+// bypasses the collection check, Wren does not expect one while resolving.
+static const char* vm_copy_string(WrenVM* vm, const char* str){
+  size_t length = strlen(str) + 1;
+  char* copy = vm_allocate(wrenGetUserData(vm), NULL, length);
+  memcpy(copy, str, length);
+  return copy;
+}
+
 static const char* resolve_module_fn(WrenVM* vm, const char* importer, const char* name){
 
   if(strcmp(name, "random") == 0 || strcmp(name, "meta") == 0){
     return name;
   }
 
-  const char* resolved;
-  if(wrt_is_file_module(name)){
-    resolved = wrt_resolve_file_module(importer, name);
-  } else {
-    resolved = name;
-  }
+  char canonical[PATH_MAX];
+  resolve_name(importer, name, canonical);
+  const char* resolved = strcmp(canonical, name) == 0 ? name : vm_copy_string(vm, canonical);
 
-  printf("Resolved: Importer: %s, Module: %s\n", importer, resolved);
+  WRT_DEBUG("Resolved: Importer: %s, Module: %s", importer, resolved);
   return resolved;
 }
 
 void wrt_run_main(WrenVM* vm, const char* main){
-  const char* script = wrt_read_file(main);
+  size_t size;
+  const char* script = wrt_map_file(main, &size);
   if(script == NULL) return;
-  WrenInterpretResult result = wrenInterpret(vm, main, script);
+  // Under its canonical name an import of the main script finds it loaded
+  char canonical[PATH_MAX];
+  const char** roots;
+  int numRoots = wrt_loader_roots(&roots);
+  wrt_canonical_file_module(roots, numRoots, main, canonical);
+  prefetch_imports(canonical, script);
+  WrenInterpretResult result = wrt_interpret(vm, canonical, script);
+  wrt_unmap_file(script, size);
   if(result == WREN_RESULT_SUCCESS){
     wrt_call_update_callbacks(vm);
   }
 }
 
-WrenVM* wrt_new_wren_vm(bool isMain){
+#define DEFAULT_OUTPUT_BUFFER 4096
+
+void wrt_init_vm_config(WrtVMConfig* config){
+  config->isMain = false;
+  config->allocator = WRT_ALLOCATOR_SYSTEM;
+  config->memoryQuota = 0;
+  config->initialHeapSize = 0;
+  config->minHeapSize = 0;
+  config->heapGrowthPercent = 0;
+  config->adaptiveHeap = false;
+  config->idleGCBudgetUs = 0;
+  config->outputBufferSize = DEFAULT_OUTPUT_BUFFER;
+}
+
+WrenVM* wrt_new_wren_vm_with_config(const WrtVMConfig* vmConfig){
+  // Registrations since the last VM are sealed in one go
+  if(ATOMIC_LOAD_INT(&numLateBindings) > 0 || ATOMIC_LOAD_PTR(&sealedBindings) == NULL){
+    wrt_seal_bindings();
+  }
+  // The VM allocates through reallocate_fn from its very first allocation,
+  // so the user data has to exist before wrenNewVM
+  WrenUserData* ud = calloc(1, sizeof(WrenUserData)); 
+  ud->isMainThread = vmConfig->isMain;
+  ud->memoryQuota = vmConfig->memoryQuota;
+  wrt_output_init(&ud->output, vmConfig->outputBufferSize);
+  if(vmConfig->allocator == WRT_ALLOCATOR_ARENA){
+    ud->arena = wrt_arena_new();
+  }
+
   WrenConfiguration config;
   wrenInitConfiguration(&config);
   
@@ -327,17 +900,272 @@ WrenVM* wrt_new_wren_vm(bool isMain){
   config.bindForeignMethodFn = bind_method_fn;
   config.bindForeignClassFn = bind_class_fn;
   config.resolveModuleFn = resolve_module_fn;
-  //config.initialHeapSize = 1024 * 1024 * 100;
-  // config.minHeapSize = 1024 * 512;
-  // config.heapGrowthPercent = 15;
+  config.reallocateFn = reallocate_fn;
+  config.userData = ud;
+  wrt_gc_configure(&ud->gc, vmConfig, &config);
   WrenVM* vm = wrenNewVM(&config);
-  WrenUserData* ud = calloc(1, sizeof(WrenUserData)); 
-  ud->isMainThread = isMain;
-  wrenSetUserData(vm, (void*)ud);
+  ud->gc.vm = vm;
   return vm;
 }
 
+WrenVM* wrt_new_wren_vm(bool isMain){
+  WrtVMConfig config;
+  wrt_init_vm_config(&config);
+  config.isMain = isMain;
+  return wrt_new_wren_vm_with_config(&config);
+}
+
+void wrt_free_wren_vm(WrenVM* vm){
+  WrenUserData* ud = (WrenUserData*)wrenGetUserData(vm);
+  if(ud->loop != NULL){
+    wrt_loop_free(ud->loop);
+  }
+  ud->gc.vm = NULL;
+  wrt_call_cache_free(&ud->calls, vm);
+  wrt_output_flush(&ud->output, vm);
+  wrenFreeVM(vm);
+  wrt_output_free(&ud->output);
+  // Everything the VM allocated from its arena goes back in one pass
+  if(ud->arena != NULL){
+    wrt_arena_free(ud->arena);
+  }
+  free(ud->pluginData);
+  free(ud->cleanPluginData);
+  arrfree(ud->updateCallbacks);
+  free(ud);
+}
+
+// Refuses to run Wren code on a VM that is stopped or still over its quota
+static bool may_run(WrenVM* vm, const char* module){
+  if(enforce_quota(vm)) return true;
+  WrenUserData* ud = (WrenUserData*)wrenGetUserData(vm);
+  error_fn(vm, WREN_ERROR_RUNTIME, module, 0, ud->halted ? "VM was stopped by its memory quota." : "Memory quota exceeded.");
+  return false;
+}
+
+// Called where a guard caught a VM that ran out of its quota reserve.
+// Guards further out are unwound as well, the code they run can not go on.
+static void stopped(WrenVM* vm, const char* module, jmp_buf* outer){
+  WrenUserData* ud = (WrenUserData*)wrenGetUserData(vm);
+  ud->quotaGuard = outer;
+  if(outer != NULL) longjmp(*outer, 1);
+  report_quota(ud);
+  error_fn(vm, WREN_ERROR_RUNTIME, module, 0, "Memory quota exceeded, the VM was stopped.");
+}
+
+WrenInterpretResult wrt_interpret(WrenVM* vm, const char* module, const char* source){
+  if(!may_run(vm, module)) return WREN_RESULT_RUNTIME_ERROR;
+  WrenUserData* ud = (WrenUserData*)wrenGetUserData(vm);
+  jmp_buf guard;
+  jmp_buf* outer = ud->quotaGuard;
+  WrenInterpretResult result;
+  if(setjmp(guard) == 0){
+    ud->quotaGuard = &guard;
+    result = wrenInterpret(vm, module, source);
+  } else {
+    stopped(vm, module, outer);
+    result = WREN_RESULT_RUNTIME_ERROR;
+  }
+  ud->quotaGuard = outer;
+  return result;
+}
+
+static WrenInterpretResult call_guarded(WrenVM* vm, const char* module, WrenHandle* method){
+  WrenUserData* ud = (WrenUserData*)wrenGetUserData(vm);
+  jmp_buf guard;
+  jmp_buf* outer = ud->quotaGuard;
+  WrenInterpretResult result;
+  if(setjmp(guard) == 0){
+    ud->quotaGuard = &guard;
+    result = wrenCall(vm, method);
+  } else {
+    stopped(vm, module, outer);
+    result = WREN_RESULT_RUNTIME_ERROR;
+  }
+  ud->quotaGuard = outer;
+  return result;
+}
+
+WrenInterpretResult wrt_call(WrenVM* vm, const char* module, const char* variable, const char* signature, const char* format, ...){
+  if(!may_run(vm, module)) return WREN_RESULT_RUNTIME_ERROR;
+  WrenUserData* ud = (WrenUserData*)wrenGetUserData(vm);
+  const WrtCachedCall* call = wrt_call_cache_get(&ud->calls, vm, module, variable, signature);
+  if(call == NULL) return WREN_RESULT_RUNTIME_ERROR;
+  int numArgs = (int)strlen(format);
+  if(numArgs != call->arity){
+    WRT_ERROR("'%s' takes %i arguments, got %i", signature, call->arity, numArgs);
+    return WREN_RESULT_RUNTIME_ERROR;
+  }
+
+  wrenEnsureSlots(vm, numArgs + 1);
+  wrenSetSlotHandle(vm, 0, call->receiver);
+  va_list args;
+  va_start(args, format);
+  for (int i = 0; i < numArgs; i++)
+  {
+    int slot = i + 1;
+    switch(format[i]){
+      case 'd': wrenSetSlotDouble(vm, slot, va_arg(args, double)); break;
+      case 'i': wrenSetSlotDouble(vm, slot, va_arg(args, int)); break;
+      case 'b': wrenSetSlotBool(vm, slot, va_arg(args, int) != 0); break;
+      case 's': wrenSetSlotString(vm, slot, va_arg(args, const char*)); break;
+      case 'h': wrenSetSlotHandle(vm, slot, va_arg(args, WrenHandle*)); break;
+      case 'n': wrenSetSlotNull(vm, slot); break;
+      default:
+        va_end(args);
+        WRT_ERROR("Unknown argument format '%c' calling '%s'", format[i], signature);
+        return WREN_RESULT_RUNTIME_ERROR;
+    }
+  }
+  va_end(args);
+  return call_guarded(vm, module, call->method);
+}
+
+WrenInterpretResult wrt_import_modules(WrenVM* vm, const char* importer, const char** modules, int numModules){
+  size_t length = 1;
+  for (int i = 0; i < numModules; i++)
+  {
+    length += strlen(modules[i]) + 10; // import "<name>"\n
+  }
+  char* source = calloc(length, sizeof(char));
+  for (int i = 0; i < numModules; i++)
+  {
+    strcat(source, "import \"");
+    strcat(source, modules[i]);
+    strcat(source, "\"\n");
+  }
+  WrenInterpretResult result = wrt_interpret(vm, importer, source);
+  free(source);
+  return result;
+}
+
+#if defined(__unix__)
+static bool forkHandlersSet = false;
+
+// No other plugin load is in flight once loadGate is held and the count is
+// down to the forking thread's own, so no other thread holds a load lock
+static void wait_for_loads(void){
+  int own = loadDepth > 0 ? 1 : 0;
+  MUTEX_LOCK(&loadGate);
+  while(ATOMIC_LOAD_INT(&pluginLoads) > own){
+    wrt_sleep_us(FORK_WAIT_US);
+  }
+}
+
+// Every runtime lock is held across fork(), outer ones first. Prefetch
+// workers and plugin loads on other threads are then between two changes,
+// a child never inherits a table that was half updated.
+static void before_fork(void){
+  wait_for_loads();
+  MUTEX_LOCK(&mutex);
+  wrt_prefetch_before_fork();
+  wrt_loader_before_fork();
+  wrt_canonical_before_fork();
+  wrt_resolve_cache_before_fork();
+  wrt_module_cache_before_fork();
+  wrt_memory_modules_before_fork();
+  MUTEX_LOCK(&bindingsMutex);
+}
+
+static void after_fork(void){
+  MUTEX_UNLOCK(&bindingsMutex);
+  wrt_memory_modules_after_fork();
+  wrt_module_cache_after_fork();
+  wrt_resolve_cache_after_fork();
+  wrt_canonical_after_fork();
+  wrt_loader_after_fork();
+  wrt_prefetch_after_fork();
+  MUTEX_UNLOCK(&mutex);
+  MUTEX_UNLOCK(&loadGate);
+}
+
+// Only the forking thread came along
+static void after_fork_in_child(void){
+  after_fork();
+  wrt_prefetch_reset_in_child();
+  wrt_log_after_fork();
+}
+#endif
+
+int wrt_zygote_fork(WrenVM* vm, WrtWorkerFn worker, int index, void* data){
+#if defined(__unix__)
+  fflush(stdout);
+  fflush(stderr);
+  wrt_flush_log();
+  // Unflushed VM output would otherwise be written by every worker
+  wrt_flush_output(vm);
+  int pid = fork();
+  if(pid != 0){
+    if(pid < 0) WRT_ERROR("Could not fork worker %i", index);
+    return pid;
+  }
+
+  wrt_log_start();
+  WrenUserData* ud = (WrenUserData*)wrenGetUserData(vm);
+  if(ud->loop != NULL){
+    wrt_loop_free_after_fork(ud->loop);
+    ud->loop = NULL;
+  }
+  int status = worker(vm, index, data);
+  wrt_flush_output(vm);
+  wrt_flush_log();
+  fflush(stdout);
+  _exit(status);
+#else
+  WRT_ERROR("Zygote workers are not supported by platform");
+  return -1;
+#endif
+}
+
+void wrt_set_module_cache_interval(uint64_t intervalUs){
+  wrt_module_cache_set_interval(intervalUs);
+  wrt_resolve_cache_set_interval(intervalUs);
+}
+
+void wrt_clear_module_cache(){
+  wrt_module_cache_clear();
+  wrt_resolve_cache_clear();
+  wrt_canonical_clear();
+  wrt_prefetch_clear();
+}
+
+void wrt_set_prefetch_threads(int threads){
+  wrt_prefetch_set_threads(threads);
+}
+
+bool wrt_add_module_source(WrtModuleSourceKind kind, const char* path, int priority){
+  if(!wrt_loader_add(kind, path, priority)) return false;
+  // Files under the new root get their installed names from now on
+  if(kind == WRT_SOURCE_DIRECTORY || kind == WRT_SOURCE_MAPPED_DIRECTORY){
+    wrt_canonical_clear();
+  }
+  return true;
+}
+
+bool wrt_mount_bundle(const char* path){
+  return wrt_add_module_source(WRT_SOURCE_BUNDLE, path, WRT_PRIORITY_BUNDLE);
+}
+
 void wrt_init(const char* mRoot){
-  moduleRoot = mRoot;
+  wrt_log_start();
   MUTEX_INIT(&mutex);
+  MUTEX_INIT(&bindingsMutex);
+  wrt_module_cache_init();
+  wrt_resolve_cache_init();
+  wrt_canonical_init();
+  wrt_memory_modules_init();
+  wrt_loader_init();
+  wrt_prefetch_init(prefetch_module);
+  wrt_loader_add(WRT_SOURCE_MEMORY, NULL, WRT_PRIORITY_MEMORY);
+  if(mRoot != NULL){
+    wrt_loader_add(WRT_SOURCE_DIRECTORY, mRoot, WRT_PRIORITY_ROOT);
+  }
+  wrt_bind_runtime_module();
+#if defined(__unix__)
+  if(!forkHandlersSet){
+    forkHandlersSet = true;
+    MUTEX_INIT(&loadGate);
+    pthread_atfork(before_fork, after_fork, after_fork_in_child);
+  }
+#endif
 }
\ No newline at end of file
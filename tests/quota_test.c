@@ -0,0 +1,50 @@
+#include <stdio.h>
+#include <wren_runtime.h>
+
+#define QUOTA (4 * 1024 * 1024)
+
+static int failures = 0;
+
+#define CHECK(condition) if(!(condition)){ fprintf(stderr, "%s:%i: %s\n", __FILE__, __LINE__, #condition); failures++; }
+
+// Never calls into the runtime, only the allocator sees it grow
+static const char* growForever =
+  "var list = []\n"
+  "while(true) list.add(list.count)\n";
+
+static WrenVM* new_vm(){
+  WrtVMConfig config;
+  wrt_init_vm_config(&config);
+  config.memoryQuota = QUOTA;
+  return wrt_new_wren_vm_with_config(&config);
+}
+
+static void test_allocation_loop_is_stopped(){
+  WrenVM* vm = new_vm();
+  CHECK(wrt_interpret(vm, "main", growForever) == WREN_RESULT_RUNTIME_ERROR);
+  WrtMemoryStats stats;
+  wrt_get_memory_stats(vm, &stats);
+  // The quota and its reserve
+  CHECK(stats.peak <= QUOTA + QUOTA / 8);
+  // A stopped VM does not run anything else
+  CHECK(wrt_interpret(vm, "main", "var a = 1\n") == WREN_RESULT_RUNTIME_ERROR);
+  wrt_free_wren_vm(vm);
+}
+
+static void test_vm_under_quota_runs(){
+  WrenVM* vm = new_vm();
+  CHECK(wrt_interpret(vm, "main", "var list = []\nfor(i in 0...1000) list.add(i)\n") == WREN_RESULT_SUCCESS);
+  wrt_free_wren_vm(vm);
+}
+
+int main(){
+  wrt_init(NULL);
+  test_allocation_loop_is_stopped();
+  test_vm_under_quota_runs();
+  wrt_flush_log();
+  if(failures > 0){
+    fprintf(stderr, "%i checks failed\n", failures);
+    return 1;
+  }
+  return 0;
+}
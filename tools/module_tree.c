@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(_WIN32)
+  #include <windows.h>
+#else
+  #include <dirent.h>
+  #include <sys/stat.h>
+#endif
+
+#include <stb_ds.h>
+
+#include "module_tree.h"
+
+#define WREN_EXTENSION ".wren"
+#define WREN_EXTENSION_LENGTH (sizeof(WREN_EXTENSION) - 1)
+// Has to match wrt_resolve_binary_module, the runtime only looks for these
+#if defined(_WIN32)
+  #define BINARY_EXTENSION ".dll"
+#else
+  #define BINARY_EXTENSION ".so"
+#endif
+
+static char* join(const char* a, const char* b){
+  size_t length = strlen(a) + 1 + strlen(b) + 1;
+  char* path = malloc(length);
+  if(a[0] == 0){
+    strcpy(path, b);
+  } else {
+    snprintf(path, length, "%s/%s", a, b);
+  }
+  return path;
+}
+
+static bool ends_with(const char* str, const char* suffix, size_t suffixLength){
+  size_t length = strlen(str);
+  return length > suffixLength && strcmp(str + length - suffixLength, suffix) == 0;
+}
+
+static char* read_file(const char* path, size_t* size){
+  FILE* file = fopen(path, "rb");
+  if(file == NULL) return NULL;
+  fseek(file, 0, SEEK_END);
+  long length = ftell(file);
+  rewind(file);
+  char* buffer = malloc((size_t)length + 1);
+  size_t read = fread(buffer, 1, (size_t)length, file);
+  fclose(file);
+  if(read != (size_t)length){
+    free(buffer);
+    return NULL;
+  }
+  buffer[length] = 0;
+  *size = (size_t)length;
+  return buffer;
+}
+
+static bool file_exists(const char* path){
+  FILE* file = fopen(path, "rb");
+  if(file == NULL) return false;
+  fclose(file);
+  return true;
+}
+
+static bool add_module(Module** modules, const char* root, const char* relative){
+  char* path = join(root, relative);
+  Module module = {0};
+  module.source = read_file(path, &module.sourceLength);
+  if(module.source == NULL){
+    fprintf(stderr, "Could not read %s\n", path);
+    free(path);
+    return false;
+  }
+  if(memchr(module.source, 0, module.sourceLength) != NULL){
+    fprintf(stderr, "Module %s contains a NUL byte\n", path);
+    free(module.source);
+    free(path);
+    return false;
+  }
+
+  size_t nameLength = strlen(relative) - WREN_EXTENSION_LENGTH;
+  module.name = malloc(nameLength + 1);
+  memcpy(module.name, relative, nameLength);
+  module.name[nameLength] = 0;
+
+  // The plugin itself stays on disk, dlopen needs a file
+  path[strlen(path) - WREN_EXTENSION_LENGTH] = 0;
+  char* binaryPath = malloc(strlen(path) + sizeof(BINARY_EXTENSION));
+  strcpy(binaryPath, path);
+  strcat(binaryPath, BINARY_EXTENSION);
+  module.hasBinary = file_exists(binaryPath);
+  free(binaryPath);
+  free(path);
+
+  arrput(*modules, module);
+  return true;
+}
+
+// Collects every .wren file below root/relative
+static bool collect(Module** modules, const char* root, const char* relative){
+  char* dir = join(root, relative);
+  bool ok = true;
+#if defined(_WIN32)
+  char* pattern = join(dir, "*");
+  WIN32_FIND_DATAA data;
+  HANDLE find = FindFirstFileA(pattern, &data);
+  free(pattern);
+  if(find == INVALID_HANDLE_VALUE){
+    fprintf(stderr, "Could not open directory %s\n", dir);
+    free(dir);
+    return false;
+  }
+  do {
+    const char* entry = data.cFileName;
+    if(strcmp(entry, ".") == 0 || strcmp(entry, "..") == 0) continue;
+    char* child = join(relative, entry);
+    if(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY){
+      ok = collect(modules, root, child) && ok;
+    } else if(ends_with(entry, WREN_EXTENSION, WREN_EXTENSION_LENGTH)){
+      ok = add_module(modules, root, child) && ok;
+    }
+    free(child);
+  } while(FindNextFileA(find, &data));
+  FindClose(find);
+#else
+  DIR* handle = opendir(dir);
+  if(handle == NULL){
+    fprintf(stderr, "Could not open directory %s\n", dir);
+    free(dir);
+    return false;
+  }
+  struct dirent* entry;
+  while((entry = readdir(handle)) != NULL){
+    if(strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+    char* child = join(relative, entry->d_name);
+    char* path = join(root, child);
+    struct stat st;
+    if(stat(path, &st) == 0){
+      if(S_ISDIR(st.st_mode)){
+        ok = collect(modules, root, child) && ok;
+      } else if(S_ISREG(st.st_mode) && ends_with(entry->d_name, WREN_EXTENSION, WREN_EXTENSION_LENGTH)){
+        ok = add_module(modules, root, child) && ok;
+      }
+    }
+    free(path);
+    free(child);
+  }
+  closedir(handle);
+#endif
+  free(dir);
+  return ok;
+}
+
+bool wrt_collect_modules(const char* root, Module** modules){
+  return collect(modules, root, "");
+}
+
+void wrt_free_modules(Module* modules){
+  for (int i = 0; i < arrlen(modules); i++)
+  {
+    free(modules[i].name);
+    free(modules[i].source);
+  }
+  arrfree(modules);
+}
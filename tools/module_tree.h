@@ -0,0 +1,22 @@
+#ifndef WRT_MODULE_TREE_H
+#define WRT_MODULE_TREE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+  // Installed module name, the path below the root without extension
+  char* name;
+  char* source;
+  size_t sourceLength;
+  // Set when a binary plugin sits next to the module
+  bool hasBinary;
+} Module;
+
+// Reads every .wren file below root into an stb_ds array, false if any of
+// them could not be read
+bool wrt_collect_modules(const char* root, Module** modules);
+void wrt_free_modules(Module* modules);
+
+#endif
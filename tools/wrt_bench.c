@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <wren_runtime.h>
+
+#include "os_call.h"
+#include "thread.h"
+
+#define CHURN_ROUNDS 20000
+#define MAX_THREADS 4
+#define IDLE_REQUESTS 2000
+
+// Builds short-lived lists of strings and keeps every sixteenth one, the
+// allocation pattern of a batch job turning records into objects
+static const char* churnScript =
+  "class Bench {\n"
+  "  static churn(rounds) {\n"
+  "    var kept = []\n"
+  "    for (i in 0...rounds) {\n"
+  "      var list = []\n"
+  "      for (j in 0...64) list.add(\"item %(j)\")\n"
+  "      if (i % 16 == 0) kept.add(list)\n"
+  "    }\n"
+  "    return kept.count\n"
+  "  }\n"
+  "}\n";
+
+// A request handler that allocates a little and keeps nothing, the pattern
+// of a server between requests
+static const char* handlerScript =
+  "class Handler {\n"
+  "  static handle() {\n"
+  "    for (i in 0...200) [i, i + 1]\n"
+  "  }\n"
+  "}\n";
+
+typedef struct {
+  WrtVMConfig config;
+  uint64_t runUs;
+  uint64_t freeUs;
+  WrtGCStats gc;
+  SEMAPHORE* done;
+} ChurnRun;
+
+static void run_churn(void* arg){
+  ChurnRun* run = (ChurnRun*)arg;
+  WrenVM* vm = wrt_new_wren_vm_with_config(&run->config);
+  uint64_t start = wrt_clock_us();
+  if(wrt_interpret(vm, "main", churnScript) != WREN_RESULT_SUCCESS
+    || wrt_call(vm, "main", "Bench", "churn(_)", "i", CHURN_ROUNDS) != WREN_RESULT_SUCCESS){
+    fprintf(stderr, "Churn script failed\n");
+  }
+  uint64_t end = wrt_clock_us();
+  wrt_get_gc_stats(vm, &run->gc);
+  wrt_free_wren_vm(vm);
+  run->runUs = end - start;
+  run->freeUs = wrt_clock_us() - end;
+  SEMAPHORE_POST(run->done);
+}
+
+// Runs one churning VM per thread, all at once, and reports the slowest
+static void churn_on_threads(const WrtVMConfig* config, int numThreads, ChurnRun* slowest){
+  SEMAPHORE done;
+  SEMAPHORE_INIT(&done);
+  ChurnRun runs[MAX_THREADS];
+  for (int i = 0; i < numThreads; i++)
+  {
+    runs[i].config = *config;
+    runs[i].done = &done;
+    THREAD thread;
+    if(THREAD_START(&thread, run_churn, &runs[i]) != 0){
+      fprintf(stderr, "Could not start thread\n");
+      exit(1);
+    }
+  }
+  for (int i = 0; i < numThreads; i++)
+  {
+    SEMAPHORE_WAIT(&done);
+  }
+  *slowest = runs[0];
+  for (int i = 1; i < numThreads; i++)
+  {
+    if(runs[i].runUs > slowest->runUs) *slowest = runs[i];
+  }
+}
+
+// System allocator against the per-VM arena, on one VM and on several VMs
+// allocating in parallel
+static void bench_arena(void){
+  const WrtAllocator allocators[] = { WRT_ALLOCATOR_SYSTEM, WRT_ALLOCATOR_ARENA };
+  const char* names[] = { "system", "arena" };
+  const int threads[] = { 1, MAX_THREADS };
+  for (int a = 0; a < 2; a++)
+  {
+    for (int t = 0; t < 2; t++)
+    {
+      WrtVMConfig config;
+      wrt_init_vm_config(&config);
+      config.allocator = allocators[a];
+      ChurnRun slowest;
+      churn_on_threads(&config, threads[t], &slowest);
+      printf("arena  %-7s %i thread(s)  run %8.1f ms  free %6.2f ms\n",
+        names[a], threads[t], slowest.runUs / 1000.0, slowest.freeUs / 1000.0);
+    }
+  }
+}
+
+// Wren's defaults against a fixed larger growth and the adaptive heap. Only
+// collections started by the runtime show up in the counts.
+static void bench_gc(void){
+  const char* names[] = { "default", "growth 200%", "adaptive" };
+  for (int i = 0; i < 3; i++)
+  {
+    WrtVMConfig config;
+    wrt_init_vm_config(&config);
+    if(i == 1) config.heapGrowthPercent = 200;
+    if(i == 2) config.adaptiveHeap = true;
+    ChurnRun run;
+    churn_on_threads(&config, 1, &run);
+    printf("gc     %-12s run %8.1f ms  collections %3llu  pauses %7.1f ms  growth %i%%\n",
+      names[i], run.runUs / 1000.0, (unsigned long long)run.gc.collections,
+      run.gc.totalPauseUs / 1000.0, run.gc.heapGrowthPercent);
+  }
+}
+
+typedef struct {
+  uint64_t latencyUs[IDLE_REQUESTS];
+  int numRequests;
+} IdleRun;
+
+static void handle_request(WrenVM* vm, void* data){
+  IdleRun* run = (IdleRun*)data;
+  uint64_t start = wrt_clock_us();
+  if(wrt_call(vm, "main", "Handler", "handle()", "") != WREN_RESULT_SUCCESS){
+    fprintf(stderr, "Handler failed\n");
+  }
+  run->latencyUs[run->numRequests++] = wrt_clock_us() - start;
+  if(run->numRequests == IDLE_REQUESTS) wrt_loop_stop(vm);
+}
+
+static int compare_us(const void* a, const void* b){
+  uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+  return x < y ? -1 : x > y;
+}
+
+// A request every millisecond, with and without collecting while the loop
+// waits for the next one. Latency is the time spent in the handler.
+static void bench_idle(void){
+  const uint64_t budgets[] = { 0, 2000 };
+  for (int i = 0; i < 2; i++)
+  {
+    WrtVMConfig config;
+    wrt_init_vm_config(&config);
+    config.idleGCBudgetUs = budgets[i];
+    WrenVM* vm = wrt_new_wren_vm_with_config(&config);
+    if(wrt_interpret(vm, "main", handlerScript) != WREN_RESULT_SUCCESS){
+      fprintf(stderr, "Handler script failed\n");
+      exit(1);
+    }
+    IdleRun* run = calloc(1, sizeof(IdleRun));
+    WrtLoopWatch* timer = wrt_loop_add_timer(vm, 1000, 1000, handle_request, run);
+    wrt_call_update_callbacks(vm);
+    wrt_loop_remove(vm, timer);
+    WrtGCStats gc;
+    wrt_get_gc_stats(vm, &gc);
+    wrt_free_wren_vm(vm);
+
+    qsort(run->latencyUs, run->numRequests, sizeof(uint64_t), compare_us);
+    uint64_t* latency = run->latencyUs;
+    int n = run->numRequests;
+    printf("idle   budget %4llu us  p50 %6.1f us  p99 %7.1f us  max %8.1f us  collections %3llu\n",
+      (unsigned long long)budgets[i], (double)latency[n / 2], (double)latency[n * 99 / 100],
+      (double)latency[n - 1], (unsigned long long)gc.collections);
+    free(run);
+  }
+}
+
+typedef struct {
+  const char* name;
+  void (*run)(void);
+} Bench;
+
+static const Bench benches[] = {
+  { "arena", bench_arena },
+  { "gc", bench_gc },
+  { "idle", bench_idle },
+};
+
+#define NUM_BENCHES (int)(sizeof(benches) / sizeof(benches[0]))
+
+int main(int argc, char** argv){
+  const char* only = argc > 1 ? argv[1] : NULL;
+  bool found = only == NULL;
+  for (int i = 0; i < NUM_BENCHES; i++)
+  {
+    if(only != NULL && strcmp(only, benches[i].name) == 0) found = true;
+  }
+  if(!found){
+    fprintf(stderr, "Usage: %s [arena|gc|idle]\n", argv[0]);
+    return 1;
+  }
+  wrt_init(NULL);
+  for (int i = 0; i < NUM_BENCHES; i++)
+  {
+    if(only == NULL || strcmp(only, benches[i].name) == 0) benches[i].run();
+  }
+  wrt_flush_log();
+  return 0;
+}
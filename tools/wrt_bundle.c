@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STB_DS_IMPLEMENTATION
+#include <stb_ds.h>
+
+#include "bundle.h"
+#include "module_tree.h"
+
+typedef struct {
+  const Module* module;
+  uint64_t hash;
+} IndexEntry;
+
+static int compare_entries(const void* a, const void* b){
+  const IndexEntry* left = a;
+  const IndexEntry* right = b;
+  if(left->hash != right->hash) return left->hash < right->hash ? -1 : 1;
+  return strcmp(left->module->name, right->module->name);
+}
+
+static bool write_bundle(const char* path, Module* modules){
+  FILE* file = fopen(path, "wb");
+  if(file == NULL){
+    fprintf(stderr, "Could not open %s for writing\n", path);
+    return false;
+  }
+
+  uint32_t count = (uint32_t)arrlen(modules);
+  WrtBundleHeader header = {0};
+  memcpy(header.magic, WRT_BUNDLE_MAGIC, sizeof(header.magic));
+  header.version = WRT_BUNDLE_VERSION;
+  header.count = count;
+
+  IndexEntry* index = calloc(count > 0 ? count : 1, sizeof(IndexEntry));
+  for (uint32_t i = 0; i < count; i++)
+  {
+    index[i].module = &modules[i];
+    index[i].hash = wrt_bundle_hash(modules[i].name);
+  }
+  qsort(index, count, sizeof(IndexEntry), compare_entries);
+
+  // Names and sources follow the index in the same order
+  WrtBundleEntry* entries = calloc(count > 0 ? count : 1, sizeof(WrtBundleEntry));
+  uint64_t offset = sizeof(WrtBundleHeader) + (uint64_t)count * sizeof(WrtBundleEntry);
+  for (uint32_t i = 0; i < count; i++)
+  {
+    const Module* module = index[i].module;
+    entries[i].hash = index[i].hash;
+    entries[i].nameOffset = offset;
+    offset += strlen(module->name) + 1;
+    entries[i].sourceOffset = offset;
+    entries[i].sourceLength = (uint32_t)module->sourceLength;
+    entries[i].flags = module->hasBinary ? WRT_BUNDLE_HAS_BINARY : 0;
+    offset += module->sourceLength + 1;
+  }
+
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+  if(count > 0) ok = ok && fwrite(entries, sizeof(WrtBundleEntry), count, file) == count;
+  for (uint32_t i = 0; i < count && ok; i++)
+  {
+    const Module* module = index[i].module;
+    ok = fwrite(module->name, 1, strlen(module->name) + 1, file) == strlen(module->name) + 1;
+    ok = ok && fwrite(module->source, 1, module->sourceLength + 1, file) == module->sourceLength + 1;
+  }
+  free(entries);
+  free(index);
+  ok = fclose(file) == 0 && ok;
+  if(!ok) fprintf(stderr, "Could not write %s\n", path);
+  return ok;
+}
+
+int main(int argc, char** argv){
+  if(argc != 3){
+    fprintf(stderr, "Usage: %s <module root> <bundle>\n", argv[0]);
+    return 1;
+  }
+
+  Module* modules = NULL;
+  bool ok = wrt_collect_modules(argv[1], &modules) && write_bundle(argv[2], modules);
+  if(ok) printf("Bundled %i modules into %s\n", (int)arrlen(modules), argv[2]);
+  wrt_free_modules(modules);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STB_DS_IMPLEMENTATION
+#include <stb_ds.h>
+
+#include "module_tree.h"
+
+#define BYTES_PER_LINE 16
+
+static int compare_modules(const void* a, const void* b){
+  return strcmp(((const Module*)a)->name, ((const Module*)b)->name);
+}
+
+static void write_string(FILE* file, const char* str){
+  fputc('"', file);
+  for(; *str; str++){
+    if(*str == '"' || *str == '\\') fputc('\\', file);
+    fputc(*str, file);
+  }
+  fputc('"', file);
+}
+
+// Sources are written as byte arrays, string literals have length limits on
+// some compilers. Both end up in read-only data shared between processes.
+static bool write_source(const char* path, const char* root, const char* function, Module* modules){
+  FILE* file = fopen(path, "w");
+  if(file == NULL){
+    fprintf(stderr, "Could not open %s for writing\n", path);
+    return false;
+  }
+
+  int count = (int)arrlen(modules);
+  fprintf(file, "// Generated by wrt_embed from %s, do not edit\n", root);
+  fprintf(file, "#include <stddef.h>\n#include <wren_runtime.h>\n\n");
+  for (int i = 0; i < count; i++)
+  {
+    fprintf(file, "static const char module_%i[] = {", i);
+    for (size_t j = 0; j <= modules[i].sourceLength; j++)
+    {
+      if(j % BYTES_PER_LINE == 0) fprintf(file, "\n ");
+      fprintf(file, " 0x%02x,", (unsigned char)modules[i].source[j]);
+    }
+    fprintf(file, "\n};\n\n");
+  }
+
+  if(count > 0){
+    fprintf(file, "static const WrtEmbeddedModule modules[] = {\n");
+    for (int i = 0; i < count; i++)
+    {
+      fprintf(file, "  { ");
+      write_string(file, modules[i].name);
+      fprintf(file, ", module_%i },\n", i);
+    }
+    fprintf(file, "};\n\n");
+  }
+
+  // The table only needs static storage, registering it before wrt_init
+  // and before main is fine
+  fprintf(file, "void %s(void){\n", function);
+  fprintf(file, "  static int added = 0;\n");
+  fprintf(file, "  if(added) return;\n");
+  fprintf(file, "  added = 1;\n");
+  fprintf(file, "  wrt_add_embedded_modules(%s, %i);\n", count > 0 ? "modules" : "NULL", count);
+  fprintf(file, "}\n\n");
+  fprintf(file, "#if defined(_MSC_VER)\n");
+  fprintf(file, "#pragma section(\".CRT$XCU\", read)\n");
+  fprintf(file, "__declspec(allocate(\".CRT$XCU\")) static void (*register_%s)(void) = %s;\n", function, function);
+  fprintf(file, "#else\n");
+  fprintf(file, "__attribute__((constructor)) static void register_%s(void){\n", function);
+  fprintf(file, "  %s();\n", function);
+  fprintf(file, "}\n");
+  fprintf(file, "#endif\n");
+
+  bool ok = !ferror(file);
+  ok = fclose(file) == 0 && ok;
+  if(!ok) fprintf(stderr, "Could not write %s\n", path);
+  return ok;
+}
+
+int main(int argc, char** argv){
+  if(argc != 4){
+    fprintf(stderr, "Usage: %s <module root> <output.c> <function>\n", argv[0]);
+    return 1;
+  }
+
+  Module* modules = NULL;
+  bool ok = wrt_collect_modules(argv[1], &modules);
+  if(ok){
+    // The runtime binary searches the table by name
+    qsort(modules, arrlen(modules), sizeof(Module), compare_modules);
+    for (int i = 0; i < arrlen(modules); i++)
+    {
+      if(modules[i].hasBinary){
+        fprintf(stderr, "Binary plugin of '%s' is not embedded, register it with wrt_register_plugin\n", modules[i].name);
+      }
+    }
+    ok = write_source(argv[2], argv[1], argv[3], modules);
+  }
+  wrt_free_modules(modules);
+  return ok ? 0 : 1;
+}